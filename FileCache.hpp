@@ -0,0 +1,118 @@
+#ifndef FILE_CACHE_HPP
+#define FILE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Mould.hpp"
+
+// Helpers shared by the on-disk caches of generated data
+
+// FNV-1a over raw bytes, so that keys stay the same between runs
+class Hasher {
+  uint64_t value;
+
+public:
+  Hasher() : value(0xcbf29ce484222325) { }
+
+  void add(const void* data, size_t size) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < size; i++)
+      value = (value ^ bytes[i]) * 0x100000001b3;
+  }
+
+  template<typename T>
+  void add(const T& x) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    add(&x, sizeof(x));
+  }
+
+  void add(const Volume& volume) {
+    for(const auto& vx : volume.get_vertices())
+      add(vx);
+    for(const auto& face : volume.get_faces()) {
+      add(face.indices.begin(), face.indices.size() * sizeof(Index));
+      add(face.normal);
+      add(face.tag);
+    }
+  }
+
+  void add(const Plane& plane) {
+    add(plane.normal);
+    add(plane.offset);
+  }
+
+  uint64_t get() const {
+    return value;
+  }
+};
+
+// A file mapped read-only into memory, or nothing if it cannot be read
+class MappedFile {
+  void* map;
+  size_t length;
+
+public:
+  MappedFile(const std::string& path) : map(MAP_FAILED), length(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+      return;
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0) {
+      length = st.st_size;
+      map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if(map != MAP_FAILED)
+      munmap(map, length);
+  }
+
+  bool empty() const {
+    return map == MAP_FAILED;
+  }
+
+  const char* data() const {
+    return static_cast<const char*>(map);
+  }
+
+  size_t size() const {
+    return empty() ? 0 : length;
+  }
+};
+
+// Name of the cache file of the given kind for the given key
+inline std::string cache_path(const char* kind, uint64_t key) {
+  char name[48];
+  std::snprintf(name, sizeof(name), "%s-%016llx.cache", kind, static_cast<unsigned long long>(key));
+  return name;
+}
+
+// Written under a temporary name first, so that an interrupted run never
+// leaves a truncated file behind
+inline void write_cache(const std::string& path, const char* data, size_t size) {
+  auto tmp = path + ".tmp";
+  std::ofstream file{tmp, std::ios::binary};
+  file.write(data, size);
+  file.close();
+  if(file)
+    std::rename(tmp.c_str(), path.c_str());
+  else
+    std::remove(tmp.c_str());
+}
+
+#endif
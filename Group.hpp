@@ -2,12 +2,16 @@
 #define GROUP_HPP
 
 #include <vector>
-#include <unordered_set>
+#include <unordered_map>
+#include <cstdint>
+#include <limits>
 #include <utility>
 #include <iterator>
 #include <algorithm>
 #include <cassert>
 
+#include "Parallel.hpp"
+
 template<class Group, class Matrix>
 class Representation;
 
@@ -18,37 +22,101 @@ struct element_traits {
   }
 };
 
+// Contiguous row-major table of element indices. Entries are stored in 16
+// bits when all of them fit after compact(), in 32 bits otherwise.
+class IndexTable {
+  std::size_t cols;
+  std::vector<std::uint16_t> narrow;
+  std::vector<std::uint32_t> wide;
+
+public:
+  IndexTable(std::size_t cols_ = 0) : cols(cols_), narrow{}, wide{} { }
+
+  std::size_t rows() const {
+    return cols == 0 ? 0 : (narrow.size() + wide.size()) / cols;
+  }
+
+  std::size_t operator()(std::size_t row, std::size_t col) const {
+    auto ix = row * cols + col;
+    return narrow.empty() ? wide[ix] : narrow[ix];
+  }
+
+  void push_back(std::size_t value) {
+    assert(narrow.empty());
+    assert(value <= std::numeric_limits<std::uint32_t>::max());
+    wide.push_back(static_cast<std::uint32_t>(value));
+  }
+
+  void resize(std::size_t rows) {
+    assert(narrow.empty());
+    wide.resize(rows * cols);
+  }
+
+  void set(std::size_t row, std::size_t col, std::size_t value) {
+    assert(narrow.empty());
+    wide[row * cols + col] = static_cast<std::uint32_t>(value);
+  }
+
+  // Call once no more entries are added
+  void compact(std::size_t max_value) {
+    if(max_value > std::numeric_limits<std::uint16_t>::max())
+      return;
+    narrow.assign(wide.begin(), wide.end());
+    wide = {};
+  }
+};
+
 template<class Element>
 class Group {
   std::vector<Element> gens;
   std::vector<Element> elems;
-  std::vector<std::vector<std::size_t>> cayley;
+  // cayley(i, j) is the index of gens[j] * elems[i]
+  IndexTable cayley;
+  std::unordered_map<Element, std::size_t> indices;
+  // Full multiplication table, computed on first request
+  mutable IndexTable products;
+  // Conjugacy classes (as element indices), computed on first request
+  mutable std::vector<std::vector<std::size_t>> classes;
+  mutable std::vector<std::size_t> class_ixs;
 
 public:
   using element_type = Element;
 
-  Group(std::vector<Element> gens_)
-    : gens(std::move(gens_)), elems{element_traits<Element>::identity()}, cayley{}
+  // The closure proceeds by breadth-first layers. All products within a
+  // layer, and their lookups among the elements known before it, are
+  // computed on up to `threads` threads (0 = all cores). New elements are
+  // then numbered sequentially in the same order as a single-threaded BFS,
+  // so indices do not depend on the thread count.
+  Group(std::vector<Element> gens_, unsigned threads = 0)
+    : gens(std::move(gens_)), elems{element_traits<Element>::identity()}, cayley{gens.size()}, indices{},
+      products{}, classes{}, class_ixs{}
   {
-    for(std::size_t i = 0; i < elems.size(); i++) {
-      const auto p = elems[i];
-      std::vector<std::size_t> c{};
-      for(const auto& g : gens) {
-        auto p1 = g*p;
-        bool found = false;
-        for(std::size_t j = 0; j < elems.size(); j++)
-          if(elems[j] == p1) {
-            c.push_back(j);
-            found = true;
-            break;
-          }
-        if(!found) {
-          c.push_back(elems.size());
-          elems.push_back(std::move(p1));
+    constexpr auto none = static_cast<std::size_t>(-1);
+    // Products are cheap, so only start threads for big enough layers
+    constexpr std::size_t min_block = 1024;
+    indices.emplace(elems.front(), 0);
+    std::vector<Element> layer{};
+    std::vector<std::size_t> found{};
+    for(std::size_t start = 0, end = 1; start < end; start = end, end = elems.size()) {
+      auto count = (end - start) * gens.size();
+      layer.resize(count);
+      found.resize(count);
+      parallel_for(count, threads, min_block, [&](std::size_t k) {
+        layer[k] = gens[k % gens.size()] * elems[start + k / gens.size()];
+        auto it = indices.find(layer[k]);
+        found[k] = it == indices.end() ? none : it->second;
+      });
+      for(std::size_t k = 0; k < count; k++) {
+        if(found[k] == none) {
+          auto [it, inserted] = indices.emplace(std::move(layer[k]), elems.size());
+          found[k] = it->second;
+          if(inserted)
+            elems.push_back(it->first);
         }
+        cayley.push_back(found[k]);
       }
-      cayley.push_back(std::move(c));
     }
+    cayley.compact(elems.size() - 1);
   }
 
   template<class Group, class Matrix>
@@ -66,35 +134,113 @@ public:
     return elems.size();
   }
 
-  std::vector<std::vector<Element>> cosets_r(const Group<Element>& subgroup) const {
-    std::vector<std::vector<Element>> ret{};
-    std::unordered_set<Element> rest{};
-    std::copy(elems.begin(), elems.end(), std::inserter(rest, rest.begin()));
-    while(rest.size() > 0) {
-      std::vector<Element> coset{};
-      auto base = *rest.begin();
+  const Element& operator[](std::size_t ix) const {
+    return elems[ix];
+  }
+
+  // Position of elm in this group, or size() if it is not a member
+  std::size_t index(const Element& elm) const {
+    auto it = indices.find(elm);
+    return it == indices.end() ? elems.size() : it->second;
+  }
+
+  // Index of elems[i] * elems[j]. The first call builds the full
+  // multiplication table, which is only sensible for small groups.
+  std::size_t product(std::size_t i, std::size_t j) const {
+    if(products.rows() == 0)
+      compute_products();
+    return products(i, j);
+  }
+
+  // Cosets g*H as indices into this group. All cosets have the size of H,
+  // so the k-th one occupies [k * subgroup.size(), (k + 1) * subgroup.size())
+  // of the result and starts with its representative.
+  std::vector<std::size_t> cosets_r(const Group<Element>& subgroup) const {
+    std::vector<std::size_t> ret{};
+    ret.reserve(elems.size());
+    std::vector<bool> seen(elems.size());
+    for(std::size_t i = 0; i < elems.size(); i++) {
+      if(seen[i])
+        continue;
       for(const auto& elm : subgroup) {
-        auto elm1 = base*elm;
-        rest.erase(std::find(rest.begin(), rest.end(), elm1));
-        coset.push_back(std::move(elm1));
+        auto j = index(elems[i]*elm);
+        assert(j < elems.size() && !seen[j]);
+        seen[j] = true;
+        ret.push_back(j);
       }
-      ret.push_back(std::move(coset));
     }
     return ret;
   }
 
+  const std::vector<std::vector<std::size_t>>& conjugacy_classes() const {
+    if(classes.empty())
+      compute_classes();
+    return classes;
+  }
+
+  // Index into conjugacy_classes() of the class of the ix-th element
+  std::size_t conj_class_index(std::size_t ix) const {
+    if(classes.empty())
+      compute_classes();
+    return class_ixs[ix];
+  }
+
   std::vector<Element> conj_class(const Element& elm) const {
-    std::unordered_set<Element> ret0{};
-    for(const auto& g : elems)
-      ret0.insert(g * elm * inverse(g));
+    auto ix = index(elm);
+    assert(ix < elems.size());
     std::vector<Element> ret{};
-    std::copy(ret0.begin(), ret0.end(), std::back_inserter(ret));
+    for(auto j : conjugacy_classes()[conj_class_index(ix)])
+      ret.push_back(elems[j]);
     return ret;
   }
 
 private:
-  auto index(const Element& elm) const {
-    return std::distance(elems.begin(), std::find(elems.begin(), elems.end(), elm));
+  // Every element but the identity was first found as gens[j] * elems[i] for
+  // some earlier i, so its row is the row of elems[i] left-multiplied by
+  // gens[j]. Rows are filled in this order.
+  void compute_products() const {
+    auto size = elems.size();
+    products = IndexTable{size};
+    products.resize(size);
+    std::vector<bool> done(size);
+    for(std::size_t k = 0; k < size; k++)
+      products.set(0, k, k);
+    done[0] = true;
+    for(std::size_t i = 0; i < size; i++)
+      for(std::size_t j = 0; j < gens.size(); j++) {
+        auto row = cayley(i, j);
+        if(done[row])
+          continue;
+        for(std::size_t k = 0; k < size; k++)
+          products.set(row, k, cayley(products(i, k), j));
+        done[row] = true;
+      }
+    products.compact(size - 1);
+  }
+
+  // Each class is the orbit of its first element under conjugation by the
+  // generators. The product g*x is read off the Cayley table.
+  void compute_classes() const {
+    constexpr auto none = static_cast<std::size_t>(-1);
+    std::vector<Element> gens_inv{};
+    for(const auto& g : gens)
+      gens_inv.push_back(inverse(g));
+    class_ixs.assign(elems.size(), none);
+    for(std::size_t i = 0; i < elems.size(); i++) {
+      if(class_ixs[i] != none)
+        continue;
+      std::vector<std::size_t> cls{i};
+      class_ixs[i] = classes.size();
+      for(std::size_t k = 0; k < cls.size(); k++)
+        for(std::size_t j = 0; j < gens.size(); j++) {
+          auto ix = index(elems[cayley(cls[k], j)] * gens_inv[j]);
+          if(class_ixs[ix] == none) {
+            class_ixs[ix] = classes.size();
+            cls.push_back(ix);
+          }
+        }
+      classes.push_back(std::move(cls));
+    }
   }
 
 };
@@ -109,15 +255,15 @@ public:
     : group(group_), elems{element_traits<Matrix>::identity()}
   {
     assert(mxs.size() == group.gens.size());
-    for(std::size_t i = 0; i < group.cayley.size(); i++) {
-      const auto& c = group.cayley[i];
+    elems.reserve(group.size());
+    for(std::size_t i = 0; i < group.cayley.rows(); i++)
       for(std::size_t j = 0; j < group.gens.size(); j++) {
-        if(c[j] >= elems.size()) {
-          assert(c[j] == elems.size());
+        auto ix = group.cayley(i, j);
+        if(ix >= elems.size()) {
+          assert(ix == elems.size());
           elems.push_back(mxs[j]*elems[i]);
         }
       }
-    }
   }
 
   auto begin() const {
@@ -132,11 +278,18 @@ public:
     return elems.size();
   }
 
-  const auto& represent(const typename Group::element_type& elm) const {
-    return elems[group.index(elm)];
+  const Matrix& represent(const typename Group::element_type& elm) const {
+    auto ix = group.index(elm);
+    assert(ix < elems.size());
+    return elems[ix];
+  }
+
+  // Matrix of the ix-th element of the group
+  const Matrix& represent_index(std::size_t ix) const {
+    return elems[ix];
   }
 
-  const auto& operator[](const typename Group::element_type& elm) const {
+  const Matrix& operator[](const typename Group::element_type& elm) const {
     return represent(elm);
   }
 
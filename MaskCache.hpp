@@ -0,0 +1,84 @@
+#ifndef MASK_CACHE_HPP
+#define MASK_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <optional>
+#include <cassert>
+
+#include "Mould.hpp"
+#include "FileCache.hpp"
+
+// The cut mask cubemap as signed 8-bit texels, the six faces of size x size
+// one after another, in a file named after the hash of everything it was
+// painted from
+class MaskCache {
+  constexpr static uint32_t version = 1;
+
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t size;
+    uint32_t reserved;
+  };
+
+  uint64_t key;
+  uint32_t size;
+  std::string path;
+  std::optional<MappedFile> file;
+
+public:
+  MaskCache(uint64_t key_, uint32_t size_) : key(key_), size(size_), path(cache_path("mask", key)), file{} { }
+
+  // The source of the program painting the mask is included, as it holds
+  // the bevel and border widths
+  static uint64_t hash(const Volume& shape, const std::vector<Cut>& shape_cuts, const std::vector<Plane>& cuts,
+      const std::string& source, uint32_t size)
+  {
+    Hasher ret{};
+    ret.add(version);
+    ret.add(shape);
+    for(const auto& cut : shape_cuts) {
+      ret.add(cut.plane);
+      ret.add(cut.tag);
+    }
+    for(const auto& plane : cuts)
+      ret.add(plane);
+    ret.add(source.data(), source.size());
+    ret.add(size);
+    return ret.get();
+  }
+
+  std::size_t texel_count() const {
+    return std::size_t{6} * size * size;
+  }
+
+  // The cached texels, valid while this object lives, or nothing if there
+  // is no usable cache file
+  std::optional<const int8_t*> load() {
+    file.emplace(path);
+    if(file->size() != sizeof(Header) + texel_count())
+      return {};
+    Header header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if(std::memcmp(header.magic, "MASK", 4) != 0 || header.version != version || header.key != key
+        || header.size != size)
+      return {};
+    return reinterpret_cast<const int8_t*>(file->data() + sizeof(Header));
+  }
+
+  void store(const std::vector<int8_t>& texels) const {
+    assert(texels.size() == texel_count());
+    Header header{{'M', 'A', 'S', 'K'}, version, key, size, 0};
+    std::vector<char> contents(sizeof(Header) + texels.size());
+    std::memcpy(contents.data(), &header, sizeof(header));
+    std::memcpy(contents.data() + sizeof(Header), texels.data(), texels.size());
+    write_cache(path, contents.data(), contents.size());
+  }
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <optional>
+#include <glm/glm.hpp>
+
+#include "Mould.hpp"
+#include "FileCache.hpp"
+
+// One vertex of the model, as uploaded
+struct ModelVertex {
+  glm::vec3 coords;
+  glm::vec3 normal;
+  glm::vec4 colour;
+  uint32_t piece;
+  uint32_t tag;
+};
+
+// Where a piece lies in the model buffers. Its indices are relative to base.
+struct PieceRange {
+  uint32_t first;
+  uint32_t count;
+  uint32_t base;
+  Vertex center;
+};
+
+// Model buffers, either owned by a Mesh or mapped from a cache file
+struct MeshData {
+  const ModelVertex* vertices;
+  size_t vertex_count;
+  const Index* indices;
+  size_t index_count;
+  const PieceRange* pieces;
+  size_t piece_count;
+};
+
+struct Mesh {
+  std::vector<ModelVertex> vertices;
+  std::vector<Index> indices;
+  std::vector<PieceRange> pieces;
+
+  MeshData data() const {
+    return {vertices.data(), vertices.size(), indices.data(), indices.size(), pieces.data(), pieces.size()};
+  }
+};
+
+// A Mesh stored in a file named after the hash of everything it was
+// generated from. The file holds a header followed by the three arrays,
+// and is read back by mapping it into memory.
+class MeshCache {
+  // The key covers the inputs only, so this has to change with any change
+  // to the code generating the mesh, down to Volume::cut()
+  constexpr static uint32_t version = 2;
+
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t vertex_count;
+    uint64_t index_count;
+    uint64_t piece_count;
+  };
+
+  uint64_t key;
+  std::string path;
+  std::optional<MappedFile> file;
+
+public:
+  MeshCache(uint64_t key_) : key(key_), path(cache_path("mesh", key)), file{} { }
+
+  // Everything the mesh is generated from
+  static uint64_t hash(const Volume& shape, const std::vector<Plane>& cuts, float bevel) {
+    Hasher ret{};
+    ret.add(version);
+    ret.add(shape);
+    for(const auto& plane : cuts)
+      ret.add(plane);
+    ret.add(bevel);
+    return ret.get();
+  }
+
+  // The cached mesh, valid while this object lives, or nothing if there is
+  // no usable cache file
+  std::optional<MeshData> load() {
+    file.emplace(path);
+    auto length = file->size();
+    if(length < sizeof(Header))
+      return {};
+    Header header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if(std::memcmp(header.magic, "MESH", 4) != 0 || header.version != version || header.key != key
+        || header.vertex_count > length || header.index_count > length || header.piece_count > length
+        || layout(header).end > length)
+      return {};
+    auto offsets = layout(header);
+    MeshData ret{
+      reinterpret_cast<const ModelVertex*>(file->data() + offsets.vertices), header.vertex_count,
+      reinterpret_cast<const Index*>(file->data() + offsets.indices), header.index_count,
+      reinterpret_cast<const PieceRange*>(file->data() + offsets.pieces), header.piece_count};
+    if(!valid(ret))
+      return {};
+    return ret;
+  }
+
+  void store(const Mesh& mesh) const {
+    Header header{{'M', 'E', 'S', 'H'}, version, key, mesh.vertices.size(), mesh.indices.size(), mesh.pieces.size()};
+    auto offsets = layout(header);
+    std::vector<char> contents(offsets.end);
+    std::memcpy(contents.data(), &header, sizeof(header));
+    std::memcpy(contents.data() + offsets.vertices, mesh.vertices.data(), mesh.vertices.size() * sizeof(ModelVertex));
+    std::memcpy(contents.data() + offsets.indices, mesh.indices.data(), mesh.indices.size() * sizeof(Index));
+    std::memcpy(contents.data() + offsets.pieces, mesh.pieces.data(), mesh.pieces.size() * sizeof(PieceRange));
+    write_cache(path, contents.data(), contents.size());
+  }
+
+private:
+  // Whether every piece only refers to indices and vertices within the
+  // arrays, as a damaged file with a sound header could say otherwise
+  static bool valid(const MeshData& mesh) {
+    for(size_t i = 0; i < mesh.piece_count; i++) {
+      const auto& piece = mesh.pieces[i];
+      if(piece.first > mesh.index_count || piece.count > mesh.index_count - piece.first
+          || piece.base >= mesh.vertex_count)
+        return false;
+      auto first = mesh.indices + piece.first;
+      for(auto ix = first; ix != first + piece.count; ix++)
+        if(*ix >= mesh.vertex_count - piece.base)
+          return false;
+    }
+    return true;
+  }
+
+  struct Offsets {
+    size_t vertices;
+    size_t indices;
+    size_t pieces;
+    size_t end;
+  };
+
+  static size_t align(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+  static Offsets layout(const Header& header) {
+    Offsets ret{};
+    ret.vertices = align(sizeof(Header), alignof(ModelVertex));
+    ret.indices = align(ret.vertices + header.vertex_count * sizeof(ModelVertex), alignof(Index));
+    ret.pieces = align(ret.indices + header.index_count * sizeof(Index), alignof(PieceRange));
+    ret.end = ret.pieces + header.piece_count * sizeof(PieceRange);
+    return ret;
+  }
+};
+
+#endif
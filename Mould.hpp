@@ -6,9 +6,16 @@
 #include <cstdint> // uint16_t
 #include <iterator>
 #include <vector>
+#include <initializer_list>
+#include <cassert>
+#include <optional>
+#include <utility>
 #include <algorithm>
+#include <memory>
 #include <glm/glm.hpp>
 
+#include "Parallel.hpp"
+
 #ifdef DEBUG
 #include <iostream>
 #endif
@@ -33,23 +40,54 @@ struct Plane {
   }
 };
 
+struct Sphere {
+  Vertex center;
+  float radius;
+};
+
+struct Box {
+  Vertex min;
+  Vertex max;
+};
+
 struct Cut {
   Plane plane;
   Index tag;
 };
 
-struct Face {
-  std::vector<Index> indices;
-  glm::vec3 normal;
-  Index tag;
+// Arithmetic used to classify vertices against a cutting plane
+enum class Precision {
+  // Single precision throughout
+  fast,
+  // Distances and intersections in double precision, and a vertex only
+  // counts as lying in the plane within robust_epsilon, which covers
+  // rounding rather than modelling error. Vertices that close are snapped
+  // onto the plane. Nearly coincident cuts then give thin but well-formed
+  // pieces rather than inconsistent ones.
+  robust
+};
 
-  Face(std::vector<Index>&& indices_, glm::vec3 normal_, Index tag_ = 0)
-    : indices(std::move(indices_)), normal(normal_), tag(tag_) { }
+// A contiguous run of vertex indices within a Volume
+class IndexRange {
+  const Index* first;
+  const Index* last;
 
-  Face(glm::vec3 normal_, Index tag_)
-    : Face({}, normal_, tag_) { }
+public:
+  IndexRange(const Index* first_, const Index* last_) : first(first_), last(last_) { }
+
+  const Index* begin() const { return first; }
+  const Index* end() const { return last; }
+  size_t size() const { return last - first; }
+  Index operator[](size_t i) const { return first[i]; }
+  Index front() const { return *first; }
+  Index back() const { return *(last - 1); }
+};
 
-  Face() : Face({}, 0) { }
+// A view of one face of a Volume, valid until the Volume is modified
+struct Face {
+  IndexRange indices;
+  glm::vec3 normal;
+  Index tag;
 
   int index(Index ix) const {
     return std::distance(indices.begin(), std::find(indices.begin(), indices.end(), ix));
@@ -82,66 +120,187 @@ struct Face {
 class Volume {
 protected:
   std::vector<Vertex> vertices;
-  std::vector<Face> faces;
+  // Faces in compressed form: the indices of all faces concatenated, face i
+  // spanning [face_starts[i], face_starts[i + 1]) of face_indices.
+  std::vector<Index> face_indices;
+  std::vector<size_t> face_starts{0};
+  std::vector<glm::vec3> face_normals;
+  std::vector<Index> face_tags;
+  // Directed edges with the faces they belong to, each packed as
+  // edge_key << 32 | face index and kept sorted, so that lookups are binary
+  // searches and copying a Volume copies one more flat buffer
+  std::vector<uint64_t> edges;
+  // Bounds of the vertices, refreshed whenever they are replaced
+  Sphere sphere{};
+  Box box{};
 
 public:
+  class FaceList {
+    const Volume& volume;
+
+  public:
+    class iterator {
+      const Volume* volume;
+      size_t ix;
+
+    public:
+      iterator(const Volume* volume_, size_t ix_) : volume(volume_), ix(ix_) { }
+      Face operator*() const { return volume->face(ix); }
+      iterator& operator++() { ix++; return *this; }
+      bool operator==(const iterator& other) const { return ix == other.ix; }
+      bool operator!=(const iterator& other) const { return ix != other.ix; }
+    };
+
+    FaceList(const Volume& volume_) : volume(volume_) { }
+
+    iterator begin() const { return {&volume, 0}; }
+    iterator end() const { return {&volume, size()}; }
+    size_t size() const { return volume.face_count(); }
+    bool empty() const { return size() == 0; }
+    Face operator[](size_t i) const { return volume.face(i); }
+  };
+
   Volume() = default;
   Volume(float size);
 
   const std::vector<Vertex>& get_vertices() const { return vertices; }
-  const std::vector<Face>& get_faces() const { return faces; }
-  bool empty() const { return faces.empty(); }
+  FaceList get_faces() const { return {*this}; }
+  bool empty() const { return face_normals.empty(); }
+
+  size_t face_count() const { return face_normals.size(); }
+
+  Face face(size_t i) const {
+    return {{face_indices.data() + face_starts[i], face_indices.data() + face_starts[i + 1]},
+      face_normals[i], face_tags[i]};
+  }
 
   Vertex center() const;
+  const Sphere& bounding_sphere() const { return sphere; }
+  const Box& bounding_box() const { return box; }
+
+  // Interval containing the signed distances of all vertices from the plane,
+  // estimated in O(1) from the bounding sphere and box
+  std::pair<float, float> distance_range(const Plane& p) const;
+  // False if the plane certainly does not cut the volume
+  bool crosses(const Plane& p, Precision precision = Precision::fast) const;
 
-  Volume cut(const Plane& p, Index tag = 0);
+  Volume cut(const Plane& p, Index tag = 0, Precision precision = Precision::fast);
   void erode(float dist);
   void dilate(float dist);
 
   constexpr static Index dilate_face_tag = -1;
+  constexpr static float epsilon = 0.001;
+  constexpr static double robust_epsilon = 1e-5;
+
+  // Distance within which a vertex counts as lying in a cutting plane
+  static double tolerance(Precision precision) {
+    return precision == Precision::robust ? robust_epsilon : epsilon;
+  }
 
 #ifdef DEBUG
   void dump() const;
 #endif
 
 private:
-  constexpr static float epsilon = 0.001;
 
-  void add_intersections(const Plane& p);
-  std::vector<Index> find_section(const Plane& p);
-  std::vector<Index> traverse_start(const Face& f, const Plane& p);
-  std::vector<Index> traverse_nbours(std::vector<Index> section, const Plane& p, Index ixPivot, Index ixNeg, Index ixPos);
-  std::vector<Index> traverse_face(std::vector<Index> section, const Plane& p, const Face& face, Index ixNeg, Index ixPos);
-  Face& find_face(Index i1, Index i2);
+  template<typename It>
+  void add_face(It first, It last, const glm::vec3& normal, Index tag = 0) {
+    face_indices.insert(face_indices.end(), first, last);
+    face_starts.push_back(face_indices.size());
+    face_normals.push_back(normal);
+    face_tags.push_back(tag);
+  }
+
+  void add_face(std::initializer_list<Index> indices, const glm::vec3& normal, Index tag = 0) {
+    add_face(indices.begin(), indices.end(), normal, tag);
+  }
+
+  void reserve_faces(size_t faces, size_t indices) {
+    face_indices.reserve(indices);
+    face_starts.reserve(faces + 1);
+    face_normals.reserve(faces);
+    face_tags.reserve(faces);
+  }
+
+  // The following take the signed distances of all vertices from the cutting plane
+  void add_intersections(std::vector<double>& dists, const Plane& p, Precision precision);
+  std::vector<Index> find_section(const std::vector<double>& dists, double eps);
+  std::vector<Index> traverse_start(const Face& f, const std::vector<double>& dists, double eps);
+  void traverse_section(std::vector<Index>& section, const std::vector<double>& dists, double eps,
+      Index ixPivot, Index ixNeg, Index ixPos);
+  static uint32_t edge_key(Index i1, Index i2) { return uint32_t(i1) << 16 | i2; }
+  void index_edges();
+  void update_bounds();
+  size_t find_face(Index i1, Index i2) const;
   void take_vertices_finalize(const Volume& orig);
 };
 
 class Mould {
   std::vector<Volume> volumes;
+  unsigned threads;
+  Precision precision;
+  // Started by the first plane which crosses enough volumes to be worth
+  // splitting, and kept for all later ones
+  std::unique_ptr<WorkerPool> pool;
+  // Volumes crossed by the current plane
+  std::vector<size_t> crossed;
+
+  // Below this many cuts per thread, starting the workers costs more than
+  // the cuts themselves
+  constexpr static size_t min_cuts_per_thread = 16;
 
 public:
 
-  Mould(Volume v) {
+  // Volumes are cut on up to `threads` threads (0 = all cores)
+  Mould(Volume v, unsigned threads_ = 0, Precision precision_ = Precision::fast)
+    : threads(threads_), precision(precision_), pool{}, crossed{}
+  {
     volumes.push_back(std::move(v));
   }
 
   void cut(const Plane& p, Index tag = 0) {
+    cut_all({p}, tag);
+  }
+
+  // Same as calling cut() with each plane in turn. Volumes which a plane
+  // misses by their bounds are skipped outright.
+  // The volumes a plane crosses are split in parallel, once there are
+  // enough of them. The new ones are appended in the order of the volumes
+  // they came from, so that the result does not depend on the thread count.
+  void cut_all(const std::vector<Plane>& planes, Index tag = 0) {
+    std::vector<std::optional<Volume>> outers{};
+    for(const auto& p : planes) {
 #ifdef DEBUG
-    std::clog << "\nMould::cut\n";
+      std::clog << "\nMould::cut\n";
 #endif
-    std::vector<Volume> nvolumes{};
-    for(auto& volume : volumes) {
-      Volume outer = volume.cut(p, tag);
-      if(volume.empty())
-        std::swap(volume, outer);
-      if(!outer.empty())
-        nvolumes.push_back(std::move(outer));
-    }
-    std::copy(std::make_move_iterator(begin(nvolumes)), std::make_move_iterator(end(nvolumes)),
-        std::back_inserter(volumes));
+      auto count = volumes.size();
+      outers.assign(count, std::nullopt);
+      crossed.clear();
+      for(size_t i = 0; i < count; i++)
+        if(volumes[i].crosses(p, precision))
+          crossed.push_back(i);
+      if(!pool && threads != 1 && crossed.size() >= 2 * min_cuts_per_thread)
+        pool = std::make_unique<WorkerPool>(threads);
+      auto split = [&](size_t k) {
+        auto i = crossed[k];
+        Volume outer = volumes[i].cut(p, tag, precision);
+        if(volumes[i].empty())
+          std::swap(volumes[i], outer);
+        if(!outer.empty())
+          outers[i] = std::move(outer);
+      };
+      if(pool)
+        pool->run(crossed.size(), min_cuts_per_thread, split);
+      else
+        for(size_t k = 0; k < crossed.size(); k++)
+          split(k);
+      for(size_t i = 0; i < count; i++)
+        if(outers[i])
+          volumes.push_back(std::move(*outers[i]));
 #ifdef DEBUG
-    std::clog << '\n' << volumes.size() << '\n';
+      std::clog << '\n' << volumes.size() << '\n';
 #endif
+    }
   }
 
   const std::vector<Volume>& get_volumes() const {
@@ -0,0 +1,148 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <utility>
+#include <exception>
+#include <algorithm>
+
+// Calls fn(k) for all k < count on up to `threads` threads (0 = all cores),
+// each taking a contiguous block of at least min_block indices. Small ranges
+// run on the calling thread. The first exception thrown by fn is rethrown
+// here once all the threads have finished.
+template<typename Fn>
+void parallel_for(std::size_t count, unsigned threads, std::size_t min_block, const Fn& fn) {
+  if(threads == 0)
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  threads = static_cast<unsigned>(std::min<std::size_t>(threads, count / std::max<std::size_t>(min_block, 1)));
+  if(threads <= 1) {
+    for(std::size_t k = 0; k < count; k++)
+      fn(k);
+    return;
+  }
+  std::exception_ptr error{};
+  std::mutex error_mutex{};
+  std::vector<std::thread> workers{};
+  for(unsigned t = 0; t < threads; t++)
+    workers.emplace_back([&fn, &error, &error_mutex, count, threads, t]() {
+      try {
+        for(auto k = count * t / threads; k < count * (t + 1) / threads; k++)
+          fn(k);
+      } catch(...) {
+        std::lock_guard<std::mutex> lock{error_mutex};
+        if(!error)
+          error = std::current_exception();
+      }
+    });
+  for(auto& worker : workers)
+    worker.join();
+  if(error)
+    std::rethrow_exception(error);
+}
+
+// A fixed set of threads running parallel_for() style loops one after
+// another. Unlike parallel_for(), it starts its threads once, so loops that
+// repeat (and the thread_local scratch of the code they call) don't pay for
+// new threads each time. The calling thread takes part in every loop.
+class WorkerPool {
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  // The current loop, valid while pending > 0
+  const std::function<void(std::size_t)>* job = nullptr;
+  std::size_t count = 0;
+  unsigned parts = 0;
+  unsigned pending = 0;
+  unsigned generation = 0;
+  bool stop = false;
+  std::exception_ptr error{};
+
+  void run_part(unsigned part) {
+    if(part >= parts)
+      return;
+    try {
+      for(auto k = count * part / parts; k < count * (part + 1) / parts; k++)
+        (*job)(k);
+    } catch(...) {
+      std::lock_guard<std::mutex> lock{mutex};
+      if(!error)
+        error = std::current_exception();
+    }
+  }
+
+  void work(unsigned part) {
+    unsigned seen = 0;
+    for(;;) {
+      std::unique_lock<std::mutex> lock{mutex};
+      wake.wait(lock, [this, seen]() { return stop || generation != seen; });
+      if(stop)
+        return;
+      seen = generation;
+      lock.unlock();
+      run_part(part);
+      lock.lock();
+      if(--pending == 0)
+        done.notify_one();
+    }
+  }
+
+public:
+  // Up to `threads` threads including the caller (0 = all cores)
+  explicit WorkerPool(unsigned threads) {
+    if(threads == 0)
+      threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for(unsigned t = 1; t < threads; t++)
+      workers.emplace_back([this, t]() { work(t); });
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      stop = true;
+    }
+    wake.notify_all();
+    for(auto& worker : workers)
+      worker.join();
+  }
+
+  unsigned size() const {
+    return static_cast<unsigned>(workers.size()) + 1;
+  }
+
+  // Same as parallel_for() on the threads of the pool
+  void run(std::size_t count_, std::size_t min_block, const std::function<void(std::size_t)>& fn) {
+    auto parts_ = static_cast<unsigned>(std::min<std::size_t>(size(), count_ / std::max<std::size_t>(min_block, 1)));
+    if(parts_ <= 1) {
+      for(std::size_t k = 0; k < count_; k++)
+        fn(k);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      job = &fn;
+      count = count_;
+      parts = parts_;
+      pending = static_cast<unsigned>(workers.size());
+      error = nullptr;
+      generation++;
+    }
+    wake.notify_all();
+    run_part(0);
+    std::unique_lock<std::mutex> lock{mutex};
+    done.wait(lock, [this]() { return pending == 0; });
+    job = nullptr;
+    if(error)
+      std::rethrow_exception(std::exchange(error, nullptr));
+  }
+};
+
+#endif
@@ -7,7 +7,6 @@
 #include <iterator>
 #include <algorithm>
 #include <utility>
-#include <numeric>
 #include <cassert>
 
 class Permutation {
@@ -15,142 +14,125 @@ public:
   using entry_type = unsigned;
   using size_type = entry_type;
   using numbered_type = unsigned long long;
-  std::vector<entry_type> cycles;
+
+private:
+  // One-line notation: images[i] is the image of i. Points beyond the end
+  // are fixed, and the list is kept trimmed so that its last entry is never
+  // a fixed point. This makes the representation canonical.
+  std::vector<entry_type> images;
 
 public:
-  Permutation() : cycles{} { }
+  Permutation() : images{} { }
 
   Permutation(const std::initializer_list<entry_type>& list_)
     : Permutation(std::vector<entry_type>{list_})
   { }
 
-  explicit Permutation(const std::vector<entry_type>& list) : cycles{} {
-    size_type size = list.size();
-    assert(size > 0);
-    std::vector<bool> used(size);
-    for(size_type start = 0u; start < size; start++) {
-      if(used[start])
-        continue;
-      if(list[start] == start)
-        continue;
-      for(auto i = start; !used[i]; i = list[i]) {
-        assert(i < size);
-        cycles.push_back(i);
-        used[i] = true;
-      }
-      cycles.push_back(start);
+  explicit Permutation(std::vector<entry_type> list) : images(std::move(list)) {
+    assert(images.size() > 0);
+#ifndef NDEBUG
+    std::vector<bool> used(images.size());
+    for(auto i : images) {
+      assert(i < images.size() && !used[i]);
+      used[i] = true;
     }
+#endif
+    _trim();
   }
 
-private:
-  struct private_tag { };
-  
-  Permutation(std::vector<entry_type>&& cycles_, const private_tag&) : cycles(std::move(cycles_)) { }
-
-public:
   static Permutation from_cycles(const std::initializer_list<std::vector<entry_type>>& cycles_) {
-    decltype(cycles) cycles{};
+    Permutation ret{};
     for(const auto& cycle : cycles_) {
       assert(cycle.size() > 0);
-      if(cycle.size() == 1)
-        continue;
-      std::copy(cycle.begin(), cycle.end(), std::back_inserter(cycles));
-      cycles.push_back(cycle.front());
+      ret._apply_cycle(cycle);
     }
-    return {std::move(cycles), private_tag{}};
+    ret._trim();
+    return ret;
   }
 
+  // The numbering is a factorial-base Lehmer code: digit i (of weight i!)
+  // counts the points k < i with p[k] > p[i]. Both directions run in
+  // O(n log n) using a Fenwick tree over the values.
+
   static Permutation from_numbered(numbered_type ix) {
-    Permutation ret{};
-    for(size_type i = 2; ix > 0; i++) {
-      auto rem = ix % i;
-      ix /= i;
-      if(rem == 0)
-        continue;
-      std::vector<entry_type> cycle(rem + 2);
-      std::iota(cycle.begin(), cycle.end() - 1, i - rem - 1);
-      cycle.back() = cycle.front();
-      ret = Permutation{std::move(cycle), private_tag{}} * ret;
-    }
+    _counter remaining{};
+    return _unrank(ix, remaining);
+  }
+
+  static std::vector<Permutation> from_numbered(const std::vector<numbered_type>& ixs) {
+    _counter remaining{};
+    std::vector<Permutation> ret{};
+    ret.reserve(ixs.size());
+    for(auto ix : ixs)
+      ret.push_back(_unrank(ix, remaining));
     return ret;
   }
 
-  static numbered_type to_numbered(Permutation p) {
-    numbered_type ret{0};
-    auto max = p._max();
-    for(auto i = max; i >= 1; i--) {
-      auto j = p[i];
-      ret *= i + 1;
-      ret += i - j;
-      std::vector<entry_type> cycle(i - j + 2);
-      std::iota(cycle.begin(), cycle.end() - 1, j);
-      std::reverse(cycle.begin(), cycle.end() - 1);
-      cycle.back() = cycle.front();
-      p = Permutation{std::move(cycle), private_tag{}} * p;
-    }
+  static numbered_type to_numbered(const Permutation& p) {
+    _counter seen{};
+    return p._rank(seen);
+  }
+
+  static std::vector<numbered_type> to_numbered(const std::vector<Permutation>& ps) {
+    _counter seen{};
+    std::vector<numbered_type> ret{};
+    ret.reserve(ps.size());
+    for(const auto& p : ps)
+      ret.push_back(p._rank(seen));
     return ret;
   }
 
   std::vector<entry_type> to_list(size_type max) const {
+    assert(max >= degree());
     std::vector<entry_type> ret(max);
-    std::iota(ret.begin(), ret.end(), 0);
-    auto cyclestart = cycles.end();
-    for(auto it = cycles.begin(); it != cycles.end(); it++) {
-      if(cyclestart == cycles.end())
-        cyclestart = it;
-      else if(*cyclestart == *it) {
-        cyclestart = cycles.end();
-        continue;
-      }
-      assert(cyclestart + 1 != cycles.end());
-      ret[*it] = *(it + 1);
-    }
+    std::copy(images.begin(), images.end(), ret.begin());
+    std::iota(ret.begin() + images.size(), ret.end(), images.size());
     return ret;
   }
 
   std::vector<entry_type> to_list() const {
-    return to_list(_max() + 1);
+    return images;
   }
 
   std::vector<std::vector<entry_type>> to_cycles() const {
     std::vector<std::vector<entry_type>> ret{};
-    for(auto it = cycles.begin(); it != cycles.end(); it++) {
-      auto it2 = std::find(it + 1, cycles.end(), *it);
+    std::vector<bool> used(degree());
+    for(size_type start = 0; start < degree(); start++) {
+      if(used[start] || images[start] == start)
+        continue;
       std::vector<entry_type> cycle{};
-      std::copy(it, it2, std::back_inserter(cycle));
+      for(auto i = start; !used[i]; i = images[i]) {
+        cycle.push_back(i);
+        used[i] = true;
+      }
       ret.push_back(std::move(cycle));
-      it = it2;
     }
     return ret;
   }
 
+  std::size_t hash() const {
+    std::size_t ret = images.size();
+    for(auto i : images)
+      ret ^= i + 0x9e3779b9 + (ret << 6) + (ret >> 2);
+    return ret;
+  }
+
+  size_type degree() const {
+    return images.size();
+  }
+
   entry_type operator[](entry_type ix) const {
-    auto it = std::find(cycles.begin(), cycles.end(), ix);
-    if(it == cycles.end())
-      return ix;
-    else
-      return *(it + 1);
+    return ix < images.size() ? images[ix] : ix;
   }
 
   friend Permutation operator*(const Permutation& p1, const Permutation& p2) {
-    std::vector<entry_type> ncycles{};
-    auto max = std::max(p1._max(), p2._max());
-    std::vector<bool> used(max);
-    for(auto start = 0u; start < max; start++) {
-      if(used[start])
-        continue;
-      used[start] = true;
-      auto next = p1[p2[start]];
-      if(next == start)
-        continue;
-      ncycles.push_back(start);
-      for(auto i = next; i != start; i = p1[p2[i]]) {
-        ncycles.push_back(i);
-        used[i] = true;
-      }
-      ncycles.push_back(start);
-    }
-    return {std::move(ncycles), private_tag{}};
+    Permutation ret{};
+    auto max = std::max(p1.degree(), p2.degree());
+    ret.images.resize(max);
+    for(size_type i = 0; i < max; i++)
+      ret.images[i] = p1[p2[i]];
+    ret._trim();
+    return ret;
   }
 
   Permutation& operator*=(const Permutation& other) {
@@ -160,15 +142,7 @@ public:
   }
 
   friend bool operator==(const Permutation& p1, const Permutation& p2) {
-    // quick check
-    if(p1.cycles.size() != p2.cycles.size())
-      return false;
-    auto n = p1._max();
-    for(auto i = 0u; i < n; i++)
-      if(p1[i] != p2[i])
-        return false;
-    // else
-    return true;
+    return p1.images == p2.images;
   }
 
   friend bool operator!=(const Permutation& p1, const Permutation& p2) {
@@ -176,13 +150,11 @@ public:
   }
 
   Permutation inverse() const {
-    std::vector<entry_type> ncycles = cycles;
-    for(auto it = ncycles.begin(); it != ncycles.end(); it++) {
-      auto it2 = std::find(it + 1, ncycles.end(), *it);
-      std::reverse(it + 1, it2);
-      it = it2;
-    }
-    return {std::move(ncycles), private_tag{}};
+    Permutation ret{};
+    ret.images.resize(degree());
+    for(size_type i = 0; i < degree(); i++)
+      ret.images[images[i]] = i;
+    return ret;
   }
 
   friend Permutation inverse(const Permutation& p) {
@@ -190,25 +162,114 @@ public:
   }
 
   int sign() const {
-    return cycles.size() % 2 ? -1 : 1;
+    size_type parity = 0;
+    for(const auto& cycle : to_cycles())
+      parity += cycle.size() - 1;
+    return parity % 2 ? -1 : 1;
   }
 
   size_type order() const {
     size_type ret = 1;
-    for(auto it = cycles.begin(); it != cycles.end(); it++) {
-      auto it2 = std::find(it + 1, cycles.end(), *it);
-      ret = std::lcm(ret, std::distance(it2, it));
-      it = it2;
-    }
+    for(const auto& cycle : to_cycles())
+      ret = std::lcm(ret, static_cast<size_type>(cycle.size()));
     return ret;
   }
 
 private:
-  entry_type _max() const {
-    if(cycles.size() == 0)
-      return 0;
-    else
-      return *std::max_element(cycles.begin(), cycles.end());
+  // Fenwick tree over a set of points [0, n)
+  class _counter {
+    std::vector<size_type> tree;
+
+  public:
+    void reset(size_type n, bool full) {
+      tree.assign(n + 1, 0);
+      if(full)
+        for(size_type i = 1; i <= n; i++)
+          tree[i] = i & -i;
+    }
+
+    void insert(size_type pos) {
+      for(pos++; pos < tree.size(); pos += pos & -pos)
+        tree[pos]++;
+    }
+
+    void erase(size_type pos) {
+      for(pos++; pos < tree.size(); pos += pos & -pos)
+        tree[pos]--;
+    }
+
+    // Number of points in the set below pos
+    size_type count_below(size_type pos) const {
+      size_type ret = 0;
+      for(; pos > 0; pos -= pos & -pos)
+        ret += tree[pos];
+      return ret;
+    }
+
+    // The k-th point (0-based) in the set
+    size_type find(size_type k) const {
+      size_type step = 1;
+      while(2 * step < tree.size())
+        step *= 2;
+      size_type pos = 0;
+      for(; step > 0; step /= 2)
+        if(pos + step < tree.size() && tree[pos + step] <= k) {
+          pos += step;
+          k -= tree[pos];
+        }
+      return pos;
+    }
+  };
+
+  numbered_type _rank(_counter& seen) const {
+    seen.reset(degree(), false);
+    numbered_type ret{0};
+    numbered_type weight{1};
+    for(size_type i = 0; i < degree(); i++) {
+      if(i > 1)
+        weight *= i;
+      ret += weight * (i - seen.count_below(images[i]));
+      seen.insert(images[i]);
+    }
+    return ret;
+  }
+
+  static Permutation _unrank(numbered_type ix, _counter& remaining) {
+    std::vector<size_type> digits{0};
+    for(size_type i = 2; ix > 0; i++) {
+      digits.push_back(ix % i);
+      ix /= i;
+    }
+    size_type size = digits.size();
+    remaining.reset(size, true);
+    Permutation ret{};
+    ret.images.resize(size);
+    for(size_type i = size; i-- > 0; ) {
+      auto image = remaining.find(i - digits[i]);
+      ret.images[i] = image;
+      remaining.erase(image);
+    }
+    ret._trim();
+    return ret;
+  }
+
+  // Writes a cycle disjoint from all the nontrivial ones already present
+  void _apply_cycle(const std::vector<entry_type>& cycle) {
+    auto max = *std::max_element(cycle.begin(), cycle.end());
+    if(max >= images.size()) {
+      auto size = images.size();
+      images.resize(max + 1);
+      std::iota(images.begin() + size, images.end(), size);
+    }
+    for(std::size_t i = 0; i < cycle.size(); i++) {
+      assert(images[cycle[i]] == cycle[i]);
+      images[cycle[i]] = cycle[(i + 1) % cycle.size()];
+    }
+  }
+
+  void _trim() {
+    while(!images.empty() && images.back() == images.size() - 1)
+      images.pop_back();
   }
 
 };
@@ -217,9 +278,9 @@ namespace std {
   template<>
   struct hash<Permutation> {
     using argument_type = Permutation;
-    using result_type = Permutation::numbered_type;
+    using result_type = std::size_t;
     result_type operator() (const Permutation& p) const {
-      return Permutation::to_numbered(p);
+      return p.hash();
     }
   };
 }
@@ -12,6 +12,13 @@
 #include "Group.hpp"
 #include "Permutation.hpp"
 
+template<>
+struct element_traits<glm::mat4> {
+  static glm::mat4 identity() {
+    return glm::mat4{1};
+  }
+};
+
 class Solid {
   
   Group<Permutation> group;
@@ -124,9 +131,10 @@ private:
   {
     Group<Permutation> subgroup{{generator}};
     std::vector<direction_pair> ret{};
-    for(const auto& coset : group.cosets_r(subgroup)) {
-      glm::mat3 matrix = {rep.represent(coset.front())};
-      ret.push_back({Permutation::to_numbered(coset.front()), matrix * ref_vector});
+    auto cosets = group.cosets_r(subgroup);
+    for(std::size_t i = 0; i < cosets.size(); i += subgroup.size()) {
+      glm::mat3 matrix = {rep.represent_index(cosets[i])};
+      ret.push_back({Permutation::to_numbered(group[cosets[i]]), matrix * ref_vector});
     }
     return ret;
   }
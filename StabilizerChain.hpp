@@ -0,0 +1,148 @@
+#ifndef STABILIZER_CHAIN_HPP
+#define STABILIZER_CHAIN_HPP
+
+#include <vector>
+#include <random>
+#include <utility>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <cassert>
+
+#include "Permutation.hpp"
+
+// A base and strong generating set of a permutation group, built by the
+// Schreier-Sims algorithm. Unlike Group<Permutation>, this never lists the
+// elements, so the order, membership and random elements are available even
+// for groups far too large to enumerate.
+class StabilizerChain {
+  using entry_type = Permutation::entry_type;
+  using size_type = Permutation::size_type;
+
+  constexpr static std::size_t npos = -1;
+
+  struct Level {
+    entry_type base;
+    std::vector<Permutation> gens;
+    std::vector<entry_type> orbit;
+    std::vector<Permutation> reps; // reps[i][base] == orbit[i]
+    std::vector<std::size_t> where; // point -> index into orbit, or npos
+
+    Level(entry_type base_, size_type degree)
+      : base(base_), gens{}, orbit{base_}, reps{Permutation{}}, where(degree, npos)
+    {
+      where[base] = 0;
+    }
+  };
+
+  size_type degree;
+  std::vector<Level> levels;
+
+public:
+  StabilizerChain(const std::vector<Permutation>& gens) : degree{0}, levels{} {
+    for(const auto& g : gens)
+      degree = std::max(degree, g.degree());
+    for(const auto& g : gens)
+      if(sift(g, 0) != Permutation{})
+        add(0, g);
+  }
+
+  std::vector<entry_type> base() const {
+    std::vector<entry_type> ret{};
+    for(const auto& level : levels)
+      ret.push_back(level.base);
+    return ret;
+  }
+
+  std::vector<std::size_t> orbit_sizes() const {
+    std::vector<std::size_t> ret{};
+    for(const auto& level : levels)
+      ret.push_back(level.orbit.size());
+    return ret;
+  }
+
+  // The group order may overflow 64 bits (it does for the 3x3x3 cube), so
+  // the result type can be chosen by the caller, e.g. long double. For
+  // integer types, std::overflow_error is thrown if the order does not fit.
+  template<typename T = Permutation::numbered_type>
+  T order() const {
+    T ret{1};
+    for(const auto& level : levels) {
+      auto factor = static_cast<T>(level.orbit.size());
+      if constexpr(std::is_integral_v<T>)
+        if(ret > std::numeric_limits<T>::max() / factor)
+          throw std::overflow_error("StabilizerChain::order() does not fit the result type");
+      ret *= factor;
+    }
+    return ret;
+  }
+
+  bool contains(const Permutation& g) const {
+    return sift(g, 0) == Permutation{};
+  }
+
+  template<class URBG>
+  Permutation random(URBG& rng) const {
+    Permutation ret{};
+    for(const auto& level : levels) {
+      std::uniform_int_distribution<std::size_t> dist{0, level.orbit.size() - 1};
+      ret *= level.reps[dist(rng)];
+    }
+    return ret;
+  }
+
+private:
+  // Strips g through the levels from the given one on. Returns the identity
+  // iff g is in the group currently represented by these levels.
+  Permutation sift(Permutation g, std::size_t from) const {
+    for(auto i = from; i < levels.size(); i++) {
+      const auto& level = levels[i];
+      auto image = g[level.base];
+      auto ix = image < degree ? level.where[image] : npos;
+      if(ix == npos)
+        return g;
+      g = inverse(level.reps[ix]) * g;
+    }
+    return g;
+  }
+
+  // Adds a generator to the given level. The generator must fix the bases of
+  // all the previous levels.
+  void add(std::size_t ix, const Permutation& g) {
+    if(ix == levels.size()) {
+      entry_type base = 0;
+      while(g[base] == base)
+        base++;
+      levels.emplace_back(base, degree);
+    }
+    levels[ix].gens.push_back(g);
+    // Points known before only need to be tried with the new generator
+    auto old_size = levels[ix].orbit.size();
+    for(std::size_t i = 0; i < old_size; i++)
+      apply_gen(ix, i, g);
+    for(std::size_t i = old_size; i < levels[ix].orbit.size(); i++)
+      for(std::size_t j = 0; j < levels[ix].gens.size(); j++)
+        apply_gen(ix, i, Permutation{levels[ix].gens[j]});
+  }
+
+  // Extends the orbit by the image of its i-th point under s, or if it is
+  // already there, makes sure the Schreier generator is in the next level.
+  void apply_gen(std::size_t ix, std::size_t i, const Permutation& s) {
+    auto& level = levels[ix];
+    auto image = s[level.orbit[i]];
+    auto rep = s * level.reps[i];
+    if(auto j = level.where[image]; j == npos) {
+      level.where[image] = level.orbit.size();
+      level.orbit.push_back(image);
+      level.reps.push_back(std::move(rep));
+    } else {
+      auto residue = sift(inverse(level.reps[j]) * rep, ix + 1);
+      if(residue != Permutation{})
+        add(ix + 1, residue);
+    }
+  }
+
+};
+
+#endif
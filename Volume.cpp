@@ -1,19 +1,45 @@
 #include "Mould.hpp"
 
-#include <map>
+#include <vector>
+#include <numeric>
 #include <initializer_list>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+  // Signed distance from the plane, evaluated in double precision
+  double distance_precise(const Vertex& vx, const Plane& p) {
+    return double(p.normal.x) * vx.x + double(p.normal.y) * vx.y + double(p.normal.z) * vx.z - double(p.offset);
+  }
+
+  // Foot of the perpendicular from vx to the plane
+  Vertex project_precise(const Vertex& vx, const Plane& p) {
+    double d = distance_precise(vx, p);
+    return {float(vx.x - d * p.normal.x), float(vx.y - d * p.normal.y), float(vx.z - d * p.normal.z)};
+  }
+
+  // Point where the segment between v1 and v2 crosses the plane
+  Vertex intersect_precise(const Vertex& v1, const Vertex& v2, const Plane& p) {
+    double d1 = distance_precise(v1, p), d2 = distance_precise(v2, p);
+    double t = d1 / (d1 - d2);
+    return {float(v1.x + t * (double(v2.x) - v1.x)), float(v1.y + t * (double(v2.y) - v1.y)),
+      float(v1.z + t * (double(v2.z) - v1.z))};
+  }
+}
 
 Volume::Volume(float size) {
   for(float x : {-size, size})
   for(float y : {-size, size})
   for(float z : {-size, size})
     vertices.push_back({x, y, z});
-  faces.push_back({{0, 2, 3, 1}, {-1, 0, 0}});
-  faces.push_back({{4, 5, 7, 6}, {1, 0, 0}});
-  faces.push_back({{0, 1, 5, 4}, {0, -1, 0}});
-  faces.push_back({{2, 6, 7, 3}, {0, 1, 0}});
-  faces.push_back({{0, 4, 6, 2}, {0, 0, -1}});
-  faces.push_back({{1, 3, 7, 5}, {0, 0, 1}});
+  add_face({0, 2, 3, 1}, {-1, 0, 0});
+  add_face({4, 5, 7, 6}, {1, 0, 0});
+  add_face({0, 1, 5, 4}, {0, -1, 0});
+  add_face({2, 6, 7, 3}, {0, 1, 0});
+  add_face({0, 4, 6, 2}, {0, 0, -1});
+  add_face({1, 3, 7, 5}, {0, 0, 1});
+  index_edges();
+  update_bounds();
 }
 
 Vertex Volume::center() const {
@@ -23,6 +49,40 @@ Vertex Volume::center() const {
   return ret / float(vertices.size());
 }
 
+void Volume::update_bounds() {
+  if(vertices.empty()) {
+    sphere = {};
+    box = {};
+    return;
+  }
+  sphere = {center(), 0};
+  box = {vertices.front(), vertices.front()};
+  for(const auto& vx : vertices) {
+    sphere.radius = std::max(sphere.radius, glm::length(vx - sphere.center));
+    box.min = glm::min(box.min, vx);
+    box.max = glm::max(box.max, vx);
+  }
+}
+
+std::pair<float, float> Volume::distance_range(const Plane& p) const {
+  float dist = sphere.center * p;
+  std::pair<float, float> ret{dist - sphere.radius, dist + sphere.radius};
+  Vertex box_center = (box.min + box.max) / 2.f;
+  Vertex half_size = (box.max - box.min) / 2.f;
+  dist = box_center * p;
+  float extent = glm::dot(half_size, glm::abs(p.normal));
+  ret.first = std::max(ret.first, dist - extent);
+  ret.second = std::min(ret.second, dist + extent);
+  return ret;
+}
+
+bool Volume::crosses(const Plane& p, Precision precision) const {
+  // Half the tolerance leaves a margin for rounding in the estimate
+  double eps = tolerance(precision);
+  auto [min, max] = distance_range(p);
+  return max >= eps / 2 && min <= -eps / 2;
+}
+
 #ifdef DEBUG
 void Volume::dump() const {
   std::clog << "VOLUME:\n";
@@ -32,7 +92,7 @@ void Volume::dump() const {
       << vertices[ix].y << ", "
       << vertices[ix].z << "}\n";
   }
-  for(const auto& f : faces) {
+  for(const auto& f : get_faces()) {
     std::clog << "{ ";
     for(auto ix : f.indices)
       std::clog << ix << ' ';
@@ -44,18 +104,40 @@ void Volume::dump() const {
 }
 #endif
 
-Volume Volume::cut(const Plane& p, Index tag) {
+Volume Volume::cut(const Plane& p, Index tag, Precision precision) {
 #ifdef DEBUG
   std::clog << "\nVolume::cut\n";
 #endif
 
-  // Simple cases
-  if(std::all_of(vertices.begin(), vertices.end(), [&p](const Vertex& vx) -> bool { return vx * p < epsilon; })) {
+  // Simple cases, decided from the bounds in O(1) where possible. The
+  // center lies within the volume, so if it is clearly outside, not all of
+  // the vertices are within the tolerance inside, and dropping all is right.
+  double eps = tolerance(precision);
+  auto [min, max] = distance_range(p);
+  bool keep_all = max < eps / 2;
+  bool drop_all = !keep_all && min > -eps / 2 && sphere.center * p > 2 * eps;
+
+  // Signed distances of all vertices, computed once and shared by all
+  // stages. Scratch storage, reused between calls.
+  thread_local std::vector<double> dists{};
+  if(!keep_all && !drop_all) {
+    dists.resize(vertices.size());
+    if(precision == Precision::robust)
+      std::transform(vertices.begin(), vertices.end(), dists.begin(),
+          [&p](const Vertex& vx) -> double { return distance_precise(vx, p); });
+    else
+      std::transform(vertices.begin(), vertices.end(), dists.begin(),
+          [&p](const Vertex& vx) -> double { return vx * p; });
+    keep_all = std::all_of(dists.begin(), dists.end(), [eps](double dot) -> bool { return dot < eps; });
+    drop_all = !keep_all && std::all_of(dists.begin(), dists.end(), [eps](double dot) -> bool { return dot > -eps; });
+  }
+
+  if(keep_all) {
 #ifdef DEBUG
     std::clog << "[keep all]\n";
 #endif
     return {};
-  } else if(std::all_of(vertices.begin(), vertices.end(), [&p](const Vertex& vx) -> bool { return vx * p > -epsilon; })) {
+  } else if(drop_all) {
 #ifdef DEBUG
     std::clog << "[drop all]\n";
 #endif
@@ -64,10 +146,17 @@ Volume Volume::cut(const Plane& p, Index tag) {
     return ret;
   }
 
-  add_intersections(p);
+  if(precision == Precision::robust)
+    for(size_t i = 0; i < vertices.size(); i++)
+      if(dists[i] != 0 && std::abs(dists[i]) < eps) {
+        vertices[i] = project_precise(vertices[i], p);
+        dists[i] = 0;
+      }
+
+  add_intersections(dists, p, precision);
 
   Volume volIn{}, volOut{};
-  std::vector<Index> section = find_section(p);
+  std::vector<Index> section = find_section(dists, eps);
   assert(!section.empty());
 #ifdef DEBUG
   std::clog << "Section: [ ";
@@ -75,24 +164,26 @@ Volume Volume::cut(const Plane& p, Index tag) {
     std::clog << ix << ' ';
   std::clog << "]\n";
 #endif
-  std::vector<Index> secReverse = section;
-  std::reverse(secReverse.begin(), secReverse.end());
-  volIn.faces.emplace_back(std::move(section), p.normal, tag);
-  volOut.faces.emplace_back(std::move(secReverse), -p.normal, tag);
+  for(Volume* vol : {&volIn, &volOut})
+    vol->reserve_faces(face_count() + 1, face_indices.size() + section.size());
+  volIn.add_face(section.begin(), section.end(), p.normal, tag);
+  volOut.add_face(section.rbegin(), section.rend(), -p.normal, tag);
 
-  for(const auto& face : faces) {
-    Face fIn{face.normal, face.tag}, fOut{face.normal, face.tag};
+  thread_local std::vector<Index> fIn{}, fOut{};
+  for(const auto& face : get_faces()) {
+    fIn.clear();
+    fOut.clear();
     for(auto ix : face.indices) {
-      auto dot = vertices[ix] * p;
-      if(dot < epsilon)
-        fIn.indices.push_back(ix);
-      if(dot > -epsilon)
-        fOut.indices.push_back(ix);
+      auto dot = dists[ix];
+      if(dot < eps)
+        fIn.push_back(ix);
+      if(dot > -eps)
+        fOut.push_back(ix);
     }
-    if(fIn.indices.size() > 2)
-      volIn.faces.push_back(std::move(fIn));
-    if(fOut.indices.size() > 2)
-      volOut.faces.push_back(std::move(fOut));
+    if(fIn.size() > 2)
+      volIn.add_face(fIn.begin(), fIn.end(), face.normal, face.tag);
+    if(fOut.size() > 2)
+      volOut.add_face(fOut.begin(), fOut.end(), face.normal, face.tag);
   }
 
   // take vertices from the original volume
@@ -110,242 +201,325 @@ Volume Volume::cut(const Plane& p, Index tag) {
 
 void Volume::erode(float dist) {
   std::vector<Cut> cuts{};
-  for(const auto& face : faces)
+  for(const auto& face : get_faces())
     cuts.push_back({{face.normal, glm::dot(face.normal, vertices[face.indices.front()]) - dist}, face.tag});
   for(const auto& cut : cuts)
     this->cut(cut.plane, cut.tag);
 }
 
 void Volume::dilate(float dist) {
-  decltype(vertices) nvertices;
-  decltype(faces) nfaces;
-  Index ix_new{0};
+  Volume ret{};
+  if(face_indices.size() > std::numeric_limits<Index>::max())
+    throw std::runtime_error("dilate(): too many vertices");
 
-  // Give each face its own set of vertices
-  for(const auto& face : faces) {
-    Face nface{face.normal, face.tag};
-    for(auto ix : face.indices) {
-      nvertices.push_back(vertices[ix]);
-      nface.indices.push_back(ix_new++);
-    }
-    nfaces.push_back(std::move(nface));
-  }
+  // Give each face its own set of vertices: the copy of the j-th vertex of
+  // the i-th face gets the index face_starts[i] + j
+  for(auto ix : face_indices)
+    ret.vertices.push_back(vertices[ix]);
+  ret.face_indices.resize(face_indices.size());
+  std::iota(ret.face_indices.begin(), ret.face_indices.end(), 0);
+  ret.face_starts = face_starts;
+  ret.face_normals = face_normals;
+  ret.face_tags = face_tags;
 
-  // Now each faces[i] has its nfaces[i], which has the same size
-  // and nfaces[i][j] is the i-th face's copy of vertex faces[i][j]
+  auto copy = [this](size_t i, size_t j) -> Index {
+    auto sz = face_starts[i + 1] - face_starts[i];
+    return face_starts[i] + j % sz;
+  };
 
   // Make new (zero area) faces for edges
-  for(const auto& face : faces) {
-    auto i = &face - &faces[0];
+  for(size_t i = 0; i < face_count(); i++) {
+    Face face = this->face(i);
     auto sz = face.indices.size();
     for(auto j = 0u; j < sz; j++) {
       Index orig1 = face[j], orig2 = face[j + 1];
       if(orig1 < orig2) {  // This condition guarantees that each edge is only counted once
-        const Face& face2 = find_face(orig2, orig1);
-        auto i2 = &face2 - &faces[0];
-        auto j2 = face2.index(orig2);
-        nfaces.push_back({{
-            nfaces[i][j + 1], nfaces[i][j],
-            nfaces[i2][j2 + 1], nfaces[i2][j2]},
-          glm::normalize(face.normal + face2.normal), dilate_face_tag});
+        size_t i2 = find_face(orig2, orig1);
+        size_t j2 = this->face(i2).index(orig2);
+        Index nface[] = {copy(i, j + 1), copy(i, j), copy(i2, j2 + 1), copy(i2, j2)};
+        ret.add_face(std::begin(nface), std::end(nface),
+            glm::normalize(face.normal + face_normals[i2]), dilate_face_tag);
       }
     }
   }
 
   // Make new zero area faces for vertices
   std::vector<bool> seen(vertices.size());
-  for(const auto& face : faces) {
-    Index i = &face - &faces[0];
+  std::vector<Index> nface{};
+  for(size_t i = 0; i < face_count(); i++) {
+    Face face = this->face(i);
     auto sz = face.indices.size();
     for(auto j = 0u; j < sz; j++) {
       Index pivot = face.indices[j];
       if(seen[pivot])
         continue;
       glm::vec3 normal{};
-      std::vector<Index> nface{nfaces[i][j]};
+      nface.assign(1, copy(i, j));
       for(Index ix = face[j + 1]; ; ) {
-        const Face& f2 = find_face(ix, pivot);
-        auto i2 = &f2 - &faces[0];
+        // A fan can't have more corners than there are vertices
+        if(nface.size() > vertices.size())
+          throw std::runtime_error("dilate(): vertex fan does not close");
+        size_t i2 = find_face(ix, pivot);
+        Face f2 = this->face(i2);
         auto j2 = f2.index(pivot);
-        Index new_ix = nfaces[i2][j2];
+        Index new_ix = copy(i2, j2);
         if(new_ix == nface.front())
           break;
         nface.push_back(new_ix);
         ix = f2[j2 + 1];
       }
-      std::reverse(nface.begin(), nface.end());
-      nfaces.emplace_back(std::move(nface), normal, dilate_face_tag);
+      ret.add_face(nface.rbegin(), nface.rend(), normal, dilate_face_tag);
       seen[pivot] = true;
     }
   }
 
   // Displace vertices
-  for(const auto& nface : nfaces) {
+  for(const auto& nface : ret.get_faces()) {
     if(nface.tag == dilate_face_tag) // Ignore extra faces
       continue;
     glm::vec3 displ = dist * nface.normal;
     for(auto ix : nface.indices)
-      nvertices[ix] += displ;
+      ret.vertices[ix] += displ;
   }
 
-  std::swap(vertices, nvertices);
-  std::swap(faces, nfaces);
+  ret.index_edges();
+  ret.update_bounds();
+  std::swap(*this, ret);
 }
 
-void Volume::add_intersections(const Plane& p) {
-  for(auto& face : faces) {
+void Volume::add_intersections(std::vector<double>& dists, const Plane& p, Precision precision) {
+  double eps = tolerance(precision);
+  // New vertices where edges cross the plane, each packed as the key of the
+  // undirected edge << 32 | new index. Scratch storage, reused between calls.
+  thread_local std::vector<uint64_t> splits{};
+  splits.clear();
+  auto crosses = [&dists, eps](Index i1, Index i2) -> bool {
+    return (dists[i1] > eps && dists[i2] < -eps) || (dists[i1] < -eps && dists[i2] > eps);
+  };
+  auto undirected = [](Index i1, Index i2) -> uint64_t {
+    return uint64_t(edge_key(std::min(i1, i2), std::max(i1, i2))) << 32;
+  };
+  for(const auto& face : get_faces()) {
     Index last_ix = face.indices.back();
-    auto last_dot = vertices[last_ix] * p;
-    for(auto i = 0u; i < face.indices.size(); i++) {
-      Index cur_ix = face.indices[i];
-      auto cur_dot = vertices[cur_ix] * p;
-      if((cur_dot > epsilon && last_dot < -epsilon) || (cur_dot < -epsilon && last_dot > epsilon)) {
-        Vertex new_vx = (cur_dot * vertices[last_ix] - last_dot * vertices[cur_ix]) / (cur_dot - last_dot);
+    for(auto cur_ix : face.indices) {
+      // Each edge is met once in either direction, so only one creates the vertex
+      if(last_ix < cur_ix && crosses(last_ix, cur_ix)) {
+        float last_dot = dists[last_ix], cur_dot = dists[cur_ix];
+        Vertex new_vx = precision == Precision::robust
+          ? intersect_precise(vertices[last_ix], vertices[cur_ix], p)
+          : (cur_dot * vertices[last_ix] - last_dot * vertices[cur_ix]) / (cur_dot - last_dot);
+        if(vertices.size() > std::numeric_limits<Index>::max())
+          throw std::runtime_error("add_intersections(): too many vertices");
         Index new_ix = static_cast<Index>(vertices.size());
         vertices.push_back(new_vx);
-        Face& f2 = find_face(cur_ix, last_ix);
+        dists.push_back(0);
+        splits.push_back(undirected(last_ix, cur_ix) | new_ix);
 #ifdef DEBUG
         std::clog << "New vertex between " << last_ix << " and " << cur_ix << ": "
           << new_vx.x << ", " << new_vx.y << ", " << new_vx.z << " [" << new_ix << "]\n";
-        std::clog << "Adding to " << face << " and " << f2 << '\n';
-#endif
-        face.indices.insert(face.indices.begin() + i, new_ix);
-        f2.indices.insert(std::find(f2.indices.begin(), f2.indices.end(), last_ix), new_ix);
-#ifdef DEBUG
-        std::clog << "-> " << face << " and " << f2 << '\n';
 #endif
       }
-      std::tie(last_ix, last_dot) = std::tie(cur_ix, cur_dot);
+      last_ix = cur_ix;
     }
   }
+  if(splits.empty())
+    return;
+  std::sort(splits.begin(), splits.end());
+
+  // Rebuild the faces with the new vertices inserted in the split edges. The
+  // old arrays are swapped into the scratch ones, to be reused next time.
+  thread_local std::vector<Index> nindices{};
+  thread_local std::vector<size_t> nstarts{};
+  nindices.clear();
+  nindices.reserve(face_indices.size() + 2 * splits.size());
+  nstarts.assign(1, 0);
+  for(const auto& face : get_faces()) {
+    Index last_ix = face.indices.back();
+    for(auto cur_ix : face.indices) {
+      if(crosses(last_ix, cur_ix)) {
+        auto key = undirected(last_ix, cur_ix);
+        auto it = std::lower_bound(splits.begin(), splits.end(), key);
+        if(it == splits.end() || (*it ^ key) >> 32 != 0)
+          throw std::runtime_error("add_intersections(): edge without a twin");
+        nindices.push_back(static_cast<Index>(*it));
+      }
+      nindices.push_back(cur_ix);
+      last_ix = cur_ix;
+    }
+    nstarts.push_back(nindices.size());
+  }
+  std::swap(face_indices, nindices);
+  std::swap(face_starts, nstarts);
+  index_edges();
 }
 
-std::vector<Index> Volume::find_section(const Plane& p) {
-  for(const auto& face : faces) {
+std::vector<Index> Volume::find_section(const std::vector<double>& dists, double eps) {
+  for(const auto& face : get_faces()) {
     unsigned cCross = 0;
     for(auto ix : face.indices) {
-      auto dot = vertices[ix] * p;
-      if(std::abs(dot) < epsilon)
+      auto dot = dists[ix];
+      if(std::abs(dot) < eps)
         cCross++;
     }
     if(cCross >= 2)
-      return traverse_start(face, p);
+      return traverse_start(face, dists, eps);
   }
   throw std::runtime_error("find_section() failed");
 }
 
-std::vector<Index> Volume::traverse_start(const Face& f, const Plane& p) {
+std::vector<Index> Volume::traverse_start(const Face& f, const std::vector<double>& dists, double eps) {
   size_t i;
   auto sz = f.indices.size();
   for(i = 0; i < sz; i++)
-    if(std::abs(vertices[f.indices[i]] * p) < epsilon)
+    if(std::abs(dists[f.indices[i]]) < eps)
       break;
   assert(i < sz);
   Index ixPivot = f[i];
   Index ixNeg = f[i + 1];
   Index ixPos = f[i - 1];
-  if(vertices[ixNeg] * p > epsilon || vertices[ixPos] * p < -epsilon) {
+  if(dists[ixNeg] > eps || dists[ixPos] < -eps) {
     for(i++; i < sz; i++)
-      if(std::abs(vertices[f.indices[i]] * p) < epsilon)
+      if(std::abs(dists[f.indices[i]]) < eps)
         break;
     assert(i < sz);
     ixPivot = f[i];
     ixNeg = f[i + 1];
     ixPos = f[i - 1];
   }
-  assert(vertices[ixNeg] * p < epsilon && vertices[ixPos] * p > -epsilon);
-  return traverse_nbours({ixPivot}, p, ixPivot, ixNeg, ixPos);
+  assert(dists[ixNeg] < eps && dists[ixPos] > -eps);
+  std::vector<Index> section{ixPivot};
+  traverse_section(section, dists, eps, ixPivot, ixNeg, ixPos);
+  return section;
 }
 
-std::vector<Index> Volume::traverse_nbours(std::vector<Index> section, const Plane& p, Index ixPivot, Index ixNeg, Index ixPos) {
+// Walks along the section polygon, appending its vertices to section until
+// the loop closes. The walk alternates between two phases: going around the
+// neighbours of a pivot vertex lying in the plane, and crossing a face whose
+// interior the plane cuts.
+void Volume::traverse_section(std::vector<Index>& section, const std::vector<double>& dists, double eps,
+    Index ixPivot, Index ixNeg, Index ixPos) {
+  // Neither the section nor the fan around a pivot can visit more vertices
+  // than there are, so on a broken mesh the walk fails instead of looping
+  for(;;) {
+    if(section.size() > vertices.size())
+      throw std::runtime_error("traverse_section(): section does not close");
 #ifdef DEBUG
-  std::clog << "Traverse neighbours: "
-    << "ixPivot = " << ixPivot
-    << ", ixNeg = " << ixNeg
-    << ", ixPos = " << ixPos << '\n';
+    std::clog << "Traverse neighbours: "
+      << "ixPivot = " << ixPivot
+      << ", ixNeg = " << ixNeg
+      << ", ixPos = " << ixPos << '\n';
 #endif
-  assert(std::abs(vertices[ixPivot] * p) < epsilon && vertices[ixNeg] * p < epsilon && vertices[ixPos] * p > -epsilon);
-  Index ix = ixNeg;
-  for(;;) {
+    assert(std::abs(dists[ixPivot]) < eps && dists[ixNeg] < eps && dists[ixPos] > -eps);
+    constexpr size_t none = -1;
+    size_t crossed = none;
+    size_t steps = 0;
+    for(Index ix = ixNeg; ; ) {
+      if(++steps > vertices.size())
+        throw std::runtime_error("traverse_nbours(): fan does not close");
 #ifdef DEBUG
-    std::clog << " ... " << ix << " (" << vertices[ix] * p << ")\n";
+      std::clog << " ... " << ix << " (" << dists[ix] << ")\n";
 #endif
-    if(std::abs(vertices[ix] * p) < epsilon) {
-      if(section.front() == ix) // loop closed, done
-        return section;
-      else {
+      if(std::abs(dists[ix]) < eps) {
+        if(section.front() == ix) // loop closed, done
+          return;
         section.push_back(ix);
-        const Face& prev_face = find_face(ix, ixPivot);
-        const Face& next_face = find_face(ixPivot, ix);
-        Index new_pos = next_face.next(ix);
-        Index new_neg = prev_face.prev(ix);
-        return traverse_nbours(section, p, ix, new_neg, new_pos);
+        Face prev_face = this->face(find_face(ix, ixPivot));
+        Face next_face = this->face(find_face(ixPivot, ix));
+        ixPos = next_face.next(ix);
+        ixNeg = prev_face.prev(ix);
+        ixPivot = ix;
+        break;
+      } else if(dists[ix] > eps) {
+        assert(ix != ixNeg);
+        crossed = find_face(ix, ixPivot);
+        ixNeg = face(crossed).next(ixPivot);
+        ixPos = ix;
+        break;
       }
-    } else if(vertices[ix] * p > epsilon) {
-      assert(ix != ixNeg);
-      const Face& prev_face = find_face(ix, ixPivot);
-      Index neg = prev_face.next(ixPivot);
-      return traverse_face(section, p, prev_face, neg, ix);
+      if(ix == ixPos)
+        throw std::runtime_error("traverse_nbours() failed!");
+      ix = this->face(find_face(ixPivot, ix)).prev(ixPivot);
     }
-    if(ix == ixPos)
-      throw std::runtime_error("traverse_nbours() failed!");
-    const Face& next_face = find_face(ixPivot, ix);
-    ix = next_face.prev(ixPivot);
-  }
-}
+    if(crossed == none) // new pivot found directly
+      continue;
 
-std::vector<Index> Volume::traverse_face(std::vector<Index> section, const Plane& p, const Face& face, Index ixNeg, Index ixPos) {
+    Face face = this->face(crossed);
 #ifdef DEBUG
-  std::clog << "Traverse face: face = " << face
-    << ", ixNeg = " << ixNeg
-    << ", ixPos = " << ixPos << '\n';
+    std::clog << "Traverse face: face = " << face
+      << ", ixNeg = " << ixNeg
+      << ", ixPos = " << ixPos << '\n';
 #endif
-  assert(vertices[ixNeg] * p < -epsilon && vertices[ixPos] * p > epsilon);
-  for(auto i = face.index(ixNeg); face[i] != ixPos; i++) {
-    Index ix = face[i];
+    assert(dists[ixNeg] < -eps && dists[ixPos] > eps);
+    auto i = face.index(ixNeg);
+    for(int end = i + int(face.indices.size()); face[i] != ixPos; i++) {
+      if(i == end)
+        throw std::runtime_error("traverse_face(): ixPos not in face");
+      Index ix = face[i];
 #ifdef DEBUG
-    std::clog << " ... " << ix << " (" << vertices[ix] * p << ")\n";
+      std::clog << " ... " << ix << " (" << dists[ix] << ")\n";
 #endif
-    if(std::abs(vertices[ix] * p) < epsilon) {
-      if(section.front() == ix) // loop closed
-        return section;
-      else {
-        section.push_back(ix);
-        return traverse_nbours(section, p, ix, face[i - 1], face[i + 1]);
-      }
+      if(std::abs(dists[ix]) < eps)
+        break;
     }
+    if(face[i] == ixPos)
+      throw std::runtime_error("traverse_face() failed!");
+    if(section.front() == face[i]) // loop closed
+      return;
+    ixPivot = face[i];
+    ixNeg = face[i - 1];
+    ixPos = face[i + 1];
+    section.push_back(ixPivot);
   }
-  throw std::runtime_error("traverse_face() failed!");
 }
 
-Face& Volume::find_face(Index i1, Index i2) {
-  for(auto& face : faces) {
+void Volume::index_edges() {
+  if(face_count() > std::numeric_limits<uint32_t>::max())
+    throw std::runtime_error("index_edges(): too many faces");
+  edges.clear();
+  edges.reserve(face_indices.size());
+  for(size_t i = 0; i < face_count(); i++) {
+    Face face = this->face(i);
     auto sz = face.indices.size();
-    for(auto i = 0u; i < sz; i++)
-      if(face[i] == i1 && face[i + 1] == i2)
-        return face;
+    for(auto j = 0u; j < sz; j++)
+      edges.push_back(uint64_t(edge_key(face[j], face[j + 1])) << 32 | i);
   }
+  std::sort(edges.begin(), edges.end());
+  auto same_edge = [](uint64_t e1, uint64_t e2) -> bool { return e1 >> 32 == e2 >> 32; };
+  if(std::adjacent_find(edges.begin(), edges.end(), same_edge) != edges.end())
+    throw std::runtime_error("index_edges(): edge shared by two faces in the same direction");
+}
+
+size_t Volume::find_face(Index i1, Index i2) const {
+  uint64_t key = edge_key(i1, i2);
+  if(auto it = std::lower_bound(edges.begin(), edges.end(), key << 32); it != edges.end() && *it >> 32 == key)
+    return *it & 0xffffffff;
   throw std::runtime_error("face not found");
 }
 
 void Volume::take_vertices_finalize(const Volume& orig) {
-  Index newIx = 0;
-  std::map<Index, Index> map{};
+  // Wider than Index, so that the sentinel can't be a valid vertex index
+  constexpr uint32_t unmapped = -1;
+  // Scratch remap table, kept between calls so that its storage is reused
+  thread_local std::vector<uint32_t> map{};
+  map.assign(orig.vertices.size(), unmapped);
+  uint32_t newIx = 0;
 #ifdef DEBUG
   std::clog << "Remap: ";
 #endif
-  for(auto& f : faces)
-    for(auto& ix : f.indices)
-      if(auto it = map.find(ix); it != map.end())
-        ix = it->second;
-      else {
-        vertices.push_back(orig.vertices[ix]);
+  for(auto& ix : face_indices)
+    if(map[ix] != unmapped)
+      ix = static_cast<Index>(map[ix]);
+    else {
+      vertices.push_back(orig.vertices[ix]);
 #ifdef DEBUG
-        std::clog << ix << "→" << newIx << ' ';
+      std::clog << ix << "→" << newIx << ' ';
 #endif
-        ix = map[ix] = newIx++;
-      }
+      map[ix] = newIx;
+      ix = static_cast<Index>(newIx++);
+    }
 #ifdef DEBUG
   std::clog << '\n';
 #endif
+  index_edges();
+  update_bounds();
 }
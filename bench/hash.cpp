@@ -0,0 +1,39 @@
+// Compares the cost of Permutation::hash() with that of ranking by
+// to_numbered(), which std::hash<Permutation> used to call.
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include "Permutation.hpp"
+
+// Keeps the results alive so that the calls are not optimized out
+volatile std::size_t sink;
+
+template<typename F>
+double time_per_call(const std::vector<Permutation>& perms, int rounds, F fn) {
+  auto start = std::chrono::steady_clock::now();
+  for(int r = 0; r < rounds; r++)
+    for(const auto& p : perms)
+      sink = sink + fn(p);
+  auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  return ns / (double(rounds) * perms.size());
+}
+
+int main() {
+  std::mt19937 rng{0};
+  for(unsigned degree : {8u, 12u, 20u}) {
+    std::vector<Permutation> perms{};
+    std::vector<Permutation::entry_type> list(degree);
+    for(int i = 0; i < 10000; i++) {
+      std::iota(list.begin(), list.end(), 0);
+      std::shuffle(list.begin(), list.end(), rng);
+      perms.emplace_back(list);
+    }
+    double hash = time_per_call(perms, 100, [](const Permutation& p) { return p.hash(); });
+    double rank = time_per_call(perms, 100, [](const Permutation& p) { return Permutation::to_numbered(p); });
+    std::printf("degree %2u: hash() %6.1f ns, to_numbered() %6.1f ns\n", degree, hash, rank);
+  }
+}
@@ -0,0 +1,136 @@
+// Counts how often cutting a cube fails with either Precision, on sets of
+// random planes where each plane comes with a nearly coincident twin, 0.2 to
+// 2 mm (epsilon / 5 to 2 epsilon) away and slightly tilted. Also times
+// Mould::cut_all() with either Precision, on those sets and on the Platonic
+// solids cut by their face and edge planes.
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <exception>
+
+#include "Mould.hpp"
+#include "Solid.hpp"
+
+constexpr int sets = 300;
+constexpr int pairs = 4;
+
+// Every directed edge has its reverse in another face
+bool closed(const Volume& v) {
+  std::vector<std::pair<Index, Index>> edges{};
+  for(const auto& face : v.get_faces())
+    for(size_t j = 0; j < face.indices.size(); j++)
+      edges.emplace_back(face[j], face[j + 1]);
+  std::sort(edges.begin(), edges.end());
+  if(std::adjacent_find(edges.begin(), edges.end()) != edges.end())
+    return false;
+  for(auto [i1, i2] : edges)
+    if(!std::binary_search(edges.begin(), edges.end(), std::pair{i2, i1}))
+      return false;
+  return true;
+}
+
+// By the divergence theorem, from a fan of triangles in each face. Faces
+// wind clockwise seen from outside.
+double volume(const Volume& v) {
+  const auto& vertices = v.get_vertices();
+  double ret = 0;
+  for(const auto& face : v.get_faces()) {
+    const Vertex& v0 = vertices[face.indices.front()];
+    for(size_t j = 1; j + 1 < face.indices.size(); j++)
+      ret += glm::dot(v0, glm::cross(vertices[face[j]], vertices[face[j + 1]]));
+  }
+  return -ret / 6;
+}
+
+struct Result {
+  bool failed;
+  std::size_t pieces;
+  double ms;
+};
+
+// Only cut_all() is timed. A failure is an exception, a piece that is not
+// closed or degenerate, or pieces not adding up to the volume of the shape.
+Result attempt(const Volume& shape, const std::vector<Plane>& planes, Precision precision) {
+  Mould mould{shape, 1, precision};
+  auto start = std::chrono::steady_clock::now();
+  try {
+    mould.cut_all(planes);
+  } catch(const std::exception&) {
+    return {true, 0, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()};
+  }
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  double total = 0;
+  for(const auto& v : mould.get_volumes()) {
+    if(v.face_count() < 4 || !closed(v))
+      return {true, 0, ms};
+    total += volume(v);
+  }
+  return {std::abs(total - volume(shape)) > 1e-3, mould.get_volumes().size(), ms};
+}
+
+void random_pairs() {
+  std::mt19937 rng{0};
+  std::uniform_real_distribution<float> coord{-1, 1}, gap{0.0002f, 0.002f}, tilt{-0.0005f, 0.0005f};
+  int failed_fast = 0, failed_robust = 0;
+  double ms_fast = 0, ms_robust = 0;
+  Volume cube{1};
+  for(int i = 0; i < sets; i++) {
+    std::vector<Plane> planes{};
+    for(int j = 0; j < pairs; j++) {
+      glm::vec3 normal{coord(rng), coord(rng), coord(rng)};
+      Plane p{normal, coord(rng) * 0.5f * glm::length(normal)};
+      planes.push_back(p);
+      planes.push_back({p.normal + glm::vec3{tilt(rng), tilt(rng), tilt(rng)}, p.offset + gap(rng)});
+    }
+    auto fast = attempt(cube, planes, Precision::fast);
+    auto robust = attempt(cube, planes, Precision::robust);
+    failed_fast += fast.failed;
+    ms_fast += fast.ms;
+    failed_robust += robust.failed;
+    ms_robust += robust.ms;
+  }
+  std::printf("%d cut sets of %d plane pairs: fast failed %d in %.1f ms, robust failed %d in %.1f ms\n",
+      sets, pairs, failed_fast, ms_fast, failed_robust, ms_robust);
+}
+
+// Best of several runs
+Result timed(const Volume& shape, const std::vector<Plane>& planes, Precision precision) {
+  Result ret = attempt(shape, planes, precision);
+  for(int run = 1; run < 10; run++)
+    ret.ms = std::min(ret.ms, attempt(shape, planes, precision).ms);
+  return ret;
+}
+
+void platonic(unsigned p, unsigned q) {
+  Solid solid = Solid::platonic(p, q);
+  Volume shape{2};
+  Index ix = 0;
+  float r_face = solid.r_face();
+  std::vector<Plane> faces{}, edges{};
+  for(const auto& [perm, vector] : solid.face_dirs()) {
+    shape.cut({vector, r_face}, ++ix);
+    faces.push_back({vector, r_face / 3});
+  }
+  float r_edge = solid.r_edge();
+  for(const auto& [perm, vector] : solid.edge_dirs())
+    edges.push_back({vector, r_edge / 2});
+  for(const auto& [name, planes] : {std::pair{"face", &faces}, std::pair{"edge", &edges}}) {
+    auto fast = timed(shape, *planes, Precision::fast);
+    auto robust = timed(shape, *planes, Precision::robust);
+    std::printf("{%u, %u} %s cuts: fast %zu pieces%s in %.2f ms, robust %zu pieces%s in %.2f ms\n",
+        p, q, name, fast.pieces, fast.failed ? " (failed)" : "", fast.ms,
+        robust.pieces, robust.failed ? " (failed)" : "", robust.ms);
+  }
+}
+
+int main() {
+  random_pairs();
+  platonic(3, 3);
+  platonic(4, 3);
+  platonic(3, 4);
+  platonic(5, 3);
+  platonic(3, 5);
+}
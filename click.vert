@@ -2,20 +2,28 @@
 
 precision mediump float;
 
+uniform highp sampler2D pieces;
 uniform mat4 matrix;
-uniform mat4 submodel;
-uniform int u_tag;
 uniform vec2 loc;
 
 layout(location = 0) in vec3 coords;
+layout(location = 1) in uint piece;
 
 flat out int tag;
 
 void main() {
+  // rows of the texture hold pieces side by side, 4 texels each
+  int per_row = textureSize(pieces, 0).x / 4;
+  ivec2 at = ivec2(int(piece) % per_row * 4, int(piece) / per_row);
+  mat4 submodel = mat4(
+      texelFetch(pieces, at + ivec2(0, 0), 0),
+      texelFetch(pieces, at + ivec2(1, 0), 0),
+      texelFetch(pieces, at + ivec2(2, 0), 0),
+      texelFetch(pieces, at + ivec2(3, 0), 0));
   vec4 pos = matrix * submodel * vec4(coords, 1);
   pos.xy /= pos.w;
   pos.xy -= loc;
   pos.w = 1.f;
   gl_Position = pos;
-  tag = u_tag;
+  tag = int(piece) + 1;
 }
@@ -1,5 +1,8 @@
 //#define DEBUG
 #include <iostream>
+#ifdef DEBUG
+#include <chrono>
+#endif
 #include "rubik.hpp"
 #include <GLFW/glfw3.h>
 
@@ -31,6 +34,17 @@ void button_cb(GLFWwindow* window, int, int action, int) {
   }
 }
 
+void cursor_cb(GLFWwindow* window, double, double) {
+  Context& ctx = *static_cast<Context*>(glfwGetWindowUserPointer(window));
+  if(ctx.ui.buttondown)
+    rotate_model(ctx, touch_location(window), false);
+}
+
+void refresh_cb(GLFWwindow* window) {
+  Context& ctx = *static_cast<Context*>(glfwGetWindowUserPointer(window));
+  ctx.dirty.frame = true;
+}
+
 void key_cb(GLFWwindow *window, unsigned key) {
   if(key == 'q')
     glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -54,12 +68,19 @@ GLFWwindow* init_glfw() {
   glfwSetCharCallback(window, key_cb);
   glfwSetFramebufferSizeCallback(window, resize_cb);
   glfwSetMouseButtonCallback(window, button_cb);
+  glfwSetCursorPosCallback(window, cursor_cb);
+  glfwSetWindowRefreshCallback(window, refresh_cb);
   glfwMakeContextCurrent(window);
   return window;
 }
 
 int main() {
   constexpr unsigned tex_cubemap = 0;
+  constexpr unsigned tex_pieces = 1;
+  constexpr unsigned ubo_cuts = 0;
+  // Paint the cut lines into a cubemap at startup, or compute them per
+  // fragment from the cutting planes
+  constexpr bool analytic_cuts = false;
 
   std::vector<Cut> shape_cuts{};
   std::vector<Plane> cuts{};
@@ -92,10 +113,29 @@ int main() {
     glfwSetWindowUserPointer(window, static_cast<void*>(&ctx));
 
     GLutil::initGLEW();
-    init_programs(ctx);
+    init_programs(ctx, ubo_cuts);
     Volume shape = init_shape(ctx, 2, shape_cuts);
-    init_model(ctx, shape, cuts, {}/*colours*/);
-    init_cubemap(ctx, tex_cubemap, shape, shape_cuts, cuts);
+    init_model(ctx, tex_pieces, shape, cuts, {}/*colours*/);
+#ifdef DEBUG
+    auto start = std::chrono::steady_clock::now();
+#endif
+    if(analytic_cuts)
+      init_cut_planes(ctx, shape_cuts, cuts);
+    else
+      init_cubemap(ctx, tex_cubemap, shape, shape_cuts, cuts);
+#ifdef DEBUG
+    glFinish();
+    std::clog << (analytic_cuts ? "init_cut_planes: " : "init_cubemap: ")
+      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+    // GPU time of each frame, where timer queries are available. Each
+    // frame reads the query of the one before, so as not to wait for it.
+    bool timer = GLEW_ARB_timer_query;
+    GLuint queries[2];
+    bool pending = false;
+    unsigned frame = 0;
+    if(timer)
+      glGenQueries(2, queries);
+#endif
     init_click_target(ctx);
 
     glEnable(GL_CULL_FACE);
@@ -103,13 +143,29 @@ int main() {
     glEnable(GL_DEPTH_TEST);
 
     resize_cb(window, 0, 0);
+    // Redraw only after something changed, sleeping until the next event
     while(!glfwWindowShouldClose(window)) {
-      glm::vec2 loc = touch_location(window);
-      if(ctx.ui.buttondown)
-        rotate_model(ctx, loc, false);
-      draw(ctx, 0/*get_click_volume(ctx, loc)*/);
-      glfwSwapBuffers(window);
-      glfwPollEvents();
+      if(ctx.dirty.frame) {
+#ifdef DEBUG
+        if(timer)
+          glBeginQuery(GL_TIME_ELAPSED, queries[frame % 2]);
+#endif
+        draw(ctx, 0/*get_click_volume(ctx, touch_location(window))*/);
+#ifdef DEBUG
+        if(timer) {
+          glEndQuery(GL_TIME_ELAPSED);
+          if(pending) {
+            GLuint64 ns;
+            glGetQueryObjectui64v(queries[(frame + 1) % 2], GL_QUERY_RESULT, &ns);
+            std::clog << "draw: " << ns / 1e6 << " ms GPU\n";
+          }
+          pending = true;
+          frame++;
+        }
+#endif
+        glfwSwapBuffers(window);
+      }
+      glfwWaitEvents();
     }
   } catch(const std::runtime_error& e) {
     std::cout.flush();
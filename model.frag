@@ -3,12 +3,28 @@
 precision highp float;
 
 uniform samplerCube sampler;
-uniform bool highlight;
+
+// Alternatively to the sampler, the mask can be computed from the cutting
+// planes directly, the same way as texgen.frag paints it
+const int max_cuts = 256;
+struct Cut {
+  vec3 normal;
+  float offset;
+  uint tag;
+};
+layout(std140) uniform Cuts {
+  Cut cuts[max_cuts];
+};
+uniform bool analytic;
+uniform int cut_count;
 
 in vec4 coords;
 in vec3 texCoord;
 in vec4 normal;
 in vec4 faceColour;
+flat in int highlighted;
+flat in vec3 faceNormal;
+flat in uint faceTag;
 
 layout(location = 0) out vec4 colour;
 
@@ -17,14 +33,34 @@ const vec4 light_dir = normalize(vec4(3, 3, -10, 0));
 const float shininess = 5.0;
 const float mix_specular = 0.3;
 const float base_brightness = 0.15;
+const float bevel_radius = 0.03;
+const float extra_border = 0.02;
 
-void main() {
-  float mask = abs(
+float analytic_mask() {
+  float ret = 1.;
+  for(int i = 0; i < cut_count; i++) {
+    if(cuts[i].tag == faceTag)
+      continue;
+    float cosine = dot(faceNormal, cuts[i].normal);
+    float sine = max(sqrt(1. - cosine * cosine), 1e-6);
+    float q1 = dot(cuts[i].normal, texCoord) - cuts[i].offset;
+    float q2 = max(abs(q1 - bevel_radius * cosine) - bevel_radius, 0.) / sine;
+    ret *= sign(q1) * pow(min(q2 / extra_border, 1.), 10.);
+  }
+  return abs(ret);
+}
+
+float sampled_mask() {
+  return abs(
       texture(sampler, texCoord).r +
       texture(sampler, texCoord + .5*dFdx(texCoord)).r +
       texture(sampler, texCoord - .5*dFdx(texCoord)).r +
       texture(sampler, texCoord + .5*dFdy(texCoord)).r +
       texture(sampler, texCoord - .5*dFdy(texCoord)).r) / 5.;
+}
+
+void main() {
+  float mask = analytic ? analytic_mask() : sampled_mask();
   vec4 properColour = mask * faceColour;
   properColour = mix(properColour, vec4(vec3(base_brightness), 1.0), 1.0 - properColour.a);
   vec4 nnormal = normalize(normal);
@@ -34,6 +70,6 @@ void main() {
   float specular_base = dot(-npos, nnormal) > 0.0 ? max(dot(-npos, -reflect(light_dir, nnormal)), 0.0) : 0.0;
   vec3 specular = vec3(pow(specular_base, shininess));
   colour = vec4(mix(diffuse, specular, mix_specular), 1);
-  if(highlight)
+  if(highlighted != 0)
     colour.rgb *= 2.f;
 }
@@ -2,23 +2,41 @@
 
 precision mediump float;
 
-uniform mat4 submodel;
+uniform highp sampler2D pieces;
 uniform mat4 modelview;
 uniform mat4 proj;
+uniform int highlight;
 
 layout(location = 0) in vec3 in_coords;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec4 in_colour;
+layout(location = 3) in uint in_piece;
+layout(location = 4) in uint in_tag;
 
 out vec4 coords;
 out vec3 texCoord;
 out vec4 normal;
 out vec4 faceColour;
+flat out int highlighted;
+flat out vec3 faceNormal;
+flat out uint faceTag;
 
 void main() {
+  int piece = int(in_piece);
+  // rows of the texture hold pieces side by side, 4 texels each
+  int per_row = textureSize(pieces, 0).x / 4;
+  ivec2 at = ivec2(piece % per_row * 4, piece / per_row);
+  mat4 submodel = mat4(
+      texelFetch(pieces, at + ivec2(0, 0), 0),
+      texelFetch(pieces, at + ivec2(1, 0), 0),
+      texelFetch(pieces, at + ivec2(2, 0), 0),
+      texelFetch(pieces, at + ivec2(3, 0), 0));
   coords = modelview * submodel * vec4(in_coords, 1);
   normal = modelview * submodel * vec4(in_normal, 0);
   texCoord = in_coords;
   faceColour = in_colour;
+  faceNormal = in_normal;
+  faceTag = in_tag;
+  highlighted = piece + 1 == highlight ? 1 : 0;
   gl_Position = proj * coords;
 }
@@ -5,12 +5,15 @@ namespace model_attribs {
   enum {
     coords,
     normal,
-    colour
+    colour,
+    piece,
+    tag
   };
 }
 
 namespace click_attribs {
   constexpr GLint coords = 0;
+  constexpr GLint piece = 1;
 }
 
 namespace texgen_attribs {
@@ -20,6 +23,30 @@ namespace texgen_attribs {
     normal
   };
 }
+
+constexpr float bevel_radius = 0.03;
+
+// The rotation of each piece takes 4 texels of the pieces texture, with up
+// to this many pieces side by side in a row. Rows alone would cap the piece
+// count at GL_MAX_TEXTURE_SIZE.
+constexpr size_t pieces_per_row = 256;
+
+// Layout of the Cuts uniform block, which must agree with model.frag,
+// including std140 alignment
+constexpr std::size_t max_cuts = 256;
+struct CutData {
+  glm::vec3 normal;
+  GLfloat offset;
+  GLuint tag;
+  GLuint padding[3];
+};
+static_assert(sizeof(CutData) == 32);
+
+// Width in pieces and height in rows of the pieces texture
+std::pair<size_t, size_t> pieces_layout(size_t count) {
+  size_t width = std::clamp<size_t>(count, 1, pieces_per_row);
+  return {width, (count + width - 1) / width};
+}
 }
 
 void update_proj(Context& ctx, int w, int h) {
@@ -32,6 +59,16 @@ void update_proj(Context& ctx, int w, int h) {
     {0, 0, 0, 1}};
   glUseProgram(ctx.gl.prog_model);
   glUniformMatrix4fv(ctx.gl.uniforms_model.proj, 1, GL_FALSE, glm::value_ptr(ctx.mxs.proj));
+  ctx.dirty.frame = true;
+}
+
+void set_modelview(Context& ctx, const glm::mat4& modelview) {
+  if(modelview == ctx.gl.modelview)
+    return;
+  glUseProgram(ctx.gl.prog_model);
+  glUniformMatrix4fv(ctx.gl.uniforms_model.modelview, 1, GL_FALSE, glm::value_ptr(modelview));
+  ctx.gl.modelview = modelview;
+  ctx.dirty.frame = true;
 }
 
 void rotate_model(Context& ctx, glm::vec2 loc, bool rewrite) {
@@ -46,26 +83,54 @@ void rotate_model(Context& ctx, glm::vec2 loc, bool rewrite) {
         glm::mat4{1},
         -modelcoord.x, {0, 1, 0}),
       modelcoord.y, {1, 0, 0}) * ctx.mxs.model;
-  glUseProgram(ctx.gl.prog_model);
-  glUniformMatrix4fv(ctx.gl.uniforms_model.modelview, 1, GL_FALSE, glm::value_ptr(ctx.mxs.view * model));
+  set_modelview(ctx, ctx.mxs.view * model);
   if(rewrite)
     ctx.mxs.model = model;
 }
 
+void upload_rotations(Context& ctx) {
+  if(!ctx.dirty.rotations)
+    return;
+  auto [width, rows] = pieces_layout(ctx.pieces.size());
+  std::vector<glm::mat4> rotations{};
+  rotations.reserve(width * rows);
+  for(const auto& piece : ctx.pieces)
+    rotations.push_back(piece.rotation);
+  // the last row is padded to full width
+  rotations.resize(width * rows, glm::mat4{1});
+  glActiveTexture(GL_TEXTURE0 + ctx.gl.texunit_pieces);
+  glBindTexture(GL_TEXTURE_2D, ctx.gl.tex_pieces);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 4 * width, rows, GL_RGBA, GL_FLOAT, rotations.data());
+  ctx.dirty.rotations = false;
+}
+
+// All the pieces in one call. The shaders find each piece's rotation by the
+// piece number stored with its vertices.
+void draw_pieces(const Context& ctx) {
+  const auto& args = ctx.gl.draw_pieces;
+  if(ctx.gl.base_vertex)
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, args.counts.data(), ctx.gl.index_type,
+        args.starts.data(), args.counts.size(), args.bases.data());
+  else
+    glDrawElements(GL_TRIANGLES, args.total, ctx.gl.index_type, nullptr);
+}
+
 void draw(Context& ctx, int t) {
   glViewport(0, 0, ctx.gl.viewport.w, ctx.gl.viewport.h);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  upload_rotations(ctx);
   glUseProgram(ctx.gl.prog_model);
   glBindVertexArray(ctx.gl.vao_model);
-  int tag = 0;
-  for(auto& piece : ctx.pieces) {
-    glUniformMatrix4fv(ctx.gl.uniforms_model.submodel, 1, GL_FALSE, glm::value_ptr(piece.rotation));
-    glUniform1i(ctx.gl.uniforms_model.highlight, ++tag == t ? GL_TRUE : GL_FALSE);
-    glDrawElements(GL_TRIANGLES, piece.gl_count, GL_UNSIGNED_SHORT, piece.gl_start);
+  if(t != ctx.gl.highlight) {
+    glUniform1i(ctx.gl.uniforms_model.highlight, t);
+    ctx.gl.highlight = t;
   }
+  draw_pieces(ctx);
+  ctx.dirty.frame = false;
 }
 
-void append_face_list(std::vector<Index>& indices, size_t base, const std::vector<Face>& faces) {
+template<typename T>
+void append_face_list(std::vector<T>& indices, size_t base, const Volume::FaceList& faces) {
   for(const auto& face : faces) {
     Index first = face.indices[0];
     Index prev = face.indices[1];
@@ -80,23 +145,33 @@ void append_face_list(std::vector<Index>& indices, size_t base, const std::vecto
   }
 }
 
-void init_programs(Context& ctx) {
+void init_programs(Context& ctx, unsigned cuts_binding) {
   ctx.gl.prog_model = GLutil::program{
     GLutil::shader{"model.vert", GL_VERTEX_SHADER, GLutil::shader::from_file},
     GLutil::shader{"model.frag", GL_FRAGMENT_SHADER, GLutil::shader::from_file}};
-  ctx.gl.uniforms_model.submodel = glGetUniformLocation(ctx.gl.prog_model, "submodel");
+  ctx.gl.uniforms_model.pieces = glGetUniformLocation(ctx.gl.prog_model, "pieces");
   ctx.gl.uniforms_model.modelview = glGetUniformLocation(ctx.gl.prog_model, "modelview");
   ctx.gl.uniforms_model.proj = glGetUniformLocation(ctx.gl.prog_model, "proj");
   ctx.gl.uniforms_model.texture = glGetUniformLocation(ctx.gl.prog_model, "sampler");
   ctx.gl.uniforms_model.highlight = glGetUniformLocation(ctx.gl.prog_model, "highlight");
+  ctx.gl.uniforms_model.analytic = glGetUniformLocation(ctx.gl.prog_model, "analytic");
+  ctx.gl.uniforms_model.cut_count = glGetUniformLocation(ctx.gl.prog_model, "cut_count");
+
+  // The Cuts block is active whether the mask is analytic or not, so it is
+  // backed by a buffer from the start, zeroed until init_cut_planes() fills it
+  std::vector<CutData> zeros(max_cuts);
+  glGenBuffers(1, &ctx.gl.ubo_cuts);
+  glBindBuffer(GL_UNIFORM_BUFFER, ctx.gl.ubo_cuts);
+  glBufferData(GL_UNIFORM_BUFFER, zeros.size() * sizeof(zeros[0]), zeros.data(), GL_STATIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, cuts_binding, ctx.gl.ubo_cuts);
+  glUniformBlockBinding(ctx.gl.prog_model, glGetUniformBlockIndex(ctx.gl.prog_model, "Cuts"), cuts_binding);
 
   ctx.gl.prog_click = GLutil::program{
     GLutil::shader{"click.vert", GL_VERTEX_SHADER, GLutil::shader::from_file},
     GLutil::shader{"click.frag", GL_FRAGMENT_SHADER, GLutil::shader::from_file}};
   ctx.gl.uniforms_click.matrix = glGetUniformLocation(ctx.gl.prog_click, "matrix");
-  ctx.gl.uniforms_click.submodel = glGetUniformLocation(ctx.gl.prog_click, "submodel");
+  ctx.gl.uniforms_click.pieces = glGetUniformLocation(ctx.gl.prog_click, "pieces");
   ctx.gl.uniforms_click.location = glGetUniformLocation(ctx.gl.prog_click, "loc");
-  ctx.gl.uniforms_click.tag = glGetUniformLocation(ctx.gl.prog_click, "u_tag");
 }
 
 Volume init_shape(Context&, float size, const std::vector<Cut>& cuts) {
@@ -106,80 +181,159 @@ Volume init_shape(Context&, float size, const std::vector<Cut>& cuts) {
   return shape;
 }
 
-void init_model(Context& ctx, const Volume& shape, const std::vector<Plane>& cuts, const std::vector<glm::vec4>& /*colour_vals*/) {
+Mesh build_mesh(const Volume& shape, const std::vector<Plane>& cuts) {
   Mould m{shape};
-  for(const auto& plane : cuts)
-    m.cut(plane);
-  
-  std::vector<glm::vec3> coords{};
-  std::vector<glm::vec3> normals{};
-  std::vector<glm::vec4> colours{};
-  std::vector<Index> indices{};
+  m.cut_all(cuts);
 
-  ctx.pieces.resize(0);
+  Mesh mesh{};
   for(auto volume : m.get_volumes()) {
-    volume.erode(0.03);
-    volume.dilate(0.03);
-    size_t base = coords.size();
-    size_t indexBase = indices.size();
-    const auto& vertices = volume.get_vertices();
-    std::copy(begin(vertices), end(vertices), std::back_inserter(coords));
+    volume.erode(bevel_radius);
+    volume.dilate(bevel_radius);
+    PieceRange range{
+      static_cast<uint32_t>(mesh.indices.size()), 0,
+      static_cast<uint32_t>(mesh.vertices.size()), volume.center()};
+    auto piece = static_cast<uint32_t>(mesh.pieces.size());
+    for(const auto& vx : volume.get_vertices())
+      mesh.vertices.push_back({vx, {}, {}, piece, 0});
+    // After dilate() every vertex belongs to exactly one face that is not
+    // a bevel
     for(const auto& face : volume.get_faces()) {
       if(face.tag == Volume::dilate_face_tag)
         continue;
-      std::fill_n(std::back_inserter(normals), face.indices.size(), face.normal);
-      std::fill_n(std::back_inserter(colours), face.indices.size(), glm::vec4(face.tag > 0 ? 1 : 0) /*colour_vals[face.tag]*/);
+      for(auto ix : face.indices) {
+        auto& vx = mesh.vertices[range.base + ix];
+        vx.normal = face.normal;
+        vx.colour = glm::vec4(face.tag > 0 ? 1 : 0) /*colour_vals[face.tag]*/;
+        vx.tag = face.tag;
+      }
     }
-    append_face_list(indices, base, volume.get_faces());
+    append_face_list(mesh.indices, 0, volume.get_faces());
+    range.count = mesh.indices.size() - range.first;
+    mesh.pieces.push_back(range);
+  }
+  return mesh;
+}
+
+void init_model(Context& ctx, unsigned texUnit, const Volume& shape, const std::vector<Plane>& cuts, const std::vector<glm::vec4>& /*colour_vals*/) {
+  // Generating the geometry is by far the slowest part of the startup, so
+  // the result is cached on disk
+  MeshCache cache{MeshCache::hash(shape, cuts, bevel_radius)};
+  Mesh generated{};
+  auto cached = cache.load();
+  if(!cached) {
+    generated = build_mesh(shape, cuts);
+    cache.store(generated);
+  }
+  MeshData mesh = cached ? *cached : generated.data();
+  auto first = [&mesh](size_t i) { return mesh.indices + mesh.pieces[i].first; };
+
+  ctx.pieces.resize(0);
+  for(size_t i = 0; i < mesh.piece_count; i++) {
+    const auto& range = mesh.pieces[i];
     ctx.pieces.push_back({
-        volume,
-        volume.center(),
+        range.center,
         glm::mat4{1},
-        reinterpret_cast<void*>(indexBase * sizeof(Index)),
-        static_cast<GLint>(indices.size() - indexBase)});
+        nullptr,
+        static_cast<GLsizei>(range.count),
+        static_cast<GLint>(range.base)});
   }
 
+  // Indices are relative to the first vertex of each piece, so always fit
+  // in 16 bits. Without base vertex draws they have to be made absolute,
+  // which takes 32 bits once the model exceeds 65536 vertices.
+  static_assert(sizeof(Index) == sizeof(GLushort));
+  ctx.gl.base_vertex = GLEW_ARB_draw_elements_base_vertex;
+  bool narrow = ctx.gl.base_vertex || mesh.vertex_count <= std::numeric_limits<Index>::max() + size_t{1};
+  ctx.gl.index_type = narrow ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  std::vector<Index> narrow_indices{};
+  std::vector<GLuint> wide_indices{};
+  for(size_t i = 0; i < ctx.pieces.size(); i++) {
+    auto& piece = ctx.pieces[i];
+    if(!ctx.gl.base_vertex) {
+      GLuint base = piece.gl_base;
+      if(narrow)
+        std::transform(first(i), first(i) + piece.gl_count, std::back_inserter(narrow_indices),
+            [base](Index ix) -> Index { return ix + base; });
+      else
+        std::transform(first(i), first(i) + piece.gl_count, std::back_inserter(wide_indices),
+            [base](Index ix) -> GLuint { return ix + base; });
+    }
+    piece.gl_start = reinterpret_cast<void*>(mesh.pieces[i].first * (narrow ? sizeof(GLushort) : sizeof(GLuint)));
+  }
+
+  auto& args = ctx.gl.draw_pieces;
+  args = {};
+  for(const auto& piece : ctx.pieces) {
+    args.counts.push_back(piece.gl_count);
+    args.starts.push_back(piece.gl_start);
+    args.bases.push_back(piece.gl_base);
+  }
+  args.total = mesh.index_count;
+
   glGenVertexArrays(1, &ctx.gl.vao_model);
   glBindVertexArray(ctx.gl.vao_model);
 
   enum {
-    COORDS_VBO,
-    NORMALS_VBO,
-    COLOURS_VBO,
+    VERTICES_VBO,
     INDICES_IBO,
     BUFFER_COUNT
   };
   GLuint buffers[BUFFER_COUNT];
   glGenBuffers(BUFFER_COUNT, &buffers[0]);
 
-  glBindBuffer(GL_ARRAY_BUFFER, buffers[COORDS_VBO]);
-  glBufferData(GL_ARRAY_BUFFER, coords.size() * sizeof(coords[0]), coords.data(), GL_STATIC_DRAW);
-  glEnableVertexAttribArray(model_attribs::coords);
-  glVertexAttribPointer(model_attribs::coords, 3, GL_FLOAT, GL_FALSE, sizeof(coords[0]), nullptr);
+  constexpr GLsizei stride = sizeof(ModelVertex);
+  auto offset = [](std::size_t offset) -> const GLvoid* { return reinterpret_cast<const GLvoid*>(offset); };
 
-  glBindBuffer(GL_ARRAY_BUFFER, buffers[NORMALS_VBO]);
-  glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(normals[0]), normals.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[VERTICES_VBO]);
+  glBufferData(GL_ARRAY_BUFFER, mesh.vertex_count * stride, mesh.vertices, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(model_attribs::coords);
+  glVertexAttribPointer(model_attribs::coords, 3, GL_FLOAT, GL_FALSE, stride, offset(offsetof(ModelVertex, coords)));
   glEnableVertexAttribArray(model_attribs::normal);
-  glVertexAttribPointer(model_attribs::normal, 3, GL_FLOAT, GL_FALSE, sizeof(normals[0]), nullptr);
-
-  glBindBuffer(GL_ARRAY_BUFFER, buffers[COLOURS_VBO]);
-  glBufferData(GL_ARRAY_BUFFER, colours.size() * sizeof(colours[0]), colours.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(model_attribs::normal, 3, GL_FLOAT, GL_FALSE, stride, offset(offsetof(ModelVertex, normal)));
   glEnableVertexAttribArray(model_attribs::colour);
-  glVertexAttribPointer(model_attribs::colour, 4, GL_FLOAT, GL_FALSE, sizeof(colours[0]), nullptr);
+  glVertexAttribPointer(model_attribs::colour, 4, GL_FLOAT, GL_FALSE, stride, offset(offsetof(ModelVertex, colour)));
+  glEnableVertexAttribArray(model_attribs::piece);
+  glVertexAttribIPointer(model_attribs::piece, 1, GL_UNSIGNED_INT, stride, offset(offsetof(ModelVertex, piece)));
+  glEnableVertexAttribArray(model_attribs::tag);
+  glVertexAttribIPointer(model_attribs::tag, 1, GL_UNSIGNED_INT, stride, offset(offsetof(ModelVertex, tag)));
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[INDICES_IBO]);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), indices.data(), GL_STATIC_DRAW);
+  if(ctx.gl.base_vertex)
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.index_count * sizeof(Index), mesh.indices, GL_STATIC_DRAW);
+  else if(narrow)
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow_indices.size() * sizeof(narrow_indices[0]), narrow_indices.data(), GL_STATIC_DRAW);
+  else
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, wide_indices.size() * sizeof(wide_indices[0]), wide_indices.data(), GL_STATIC_DRAW);
 
   // a simplified VAO for click event processing
 
   glGenVertexArrays(1, &ctx.gl.vao_click);
   glBindVertexArray(ctx.gl.vao_click);
 
-  glBindBuffer(GL_ARRAY_BUFFER, buffers[COORDS_VBO]);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[VERTICES_VBO]);
   glEnableVertexAttribArray(click_attribs::coords);
-  glVertexAttribPointer(click_attribs::coords, 3, GL_FLOAT, GL_FALSE, sizeof(coords[0]), nullptr);
+  glVertexAttribPointer(click_attribs::coords, 3, GL_FLOAT, GL_FALSE, stride, offset(offsetof(ModelVertex, coords)));
+  glEnableVertexAttribArray(click_attribs::piece);
+  glVertexAttribIPointer(click_attribs::piece, 1, GL_UNSIGNED_INT, stride, offset(offsetof(ModelVertex, piece)));
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[INDICES_IBO]);
 
+  // piece rotations, filled in by upload_rotations()
+
+  auto [width, rows] = pieces_layout(ctx.pieces.size());
+  GLint max_size;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+  if(rows > static_cast<size_t>(max_size))
+    throw std::runtime_error("init_model: too many pieces for GL_MAX_TEXTURE_SIZE");
+  ctx.gl.texunit_pieces = texUnit;
+  glGenTextures(1, &ctx.gl.tex_pieces);
+  glActiveTexture(GL_TEXTURE0 + texUnit);
+  glBindTexture(GL_TEXTURE_2D, ctx.gl.tex_pieces);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 4 * width, rows, 0, GL_RGBA, GL_FLOAT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glUseProgram(ctx.gl.prog_click);
+  glUniform1i(ctx.gl.uniforms_click.pieces, texUnit);
+
   ctx.mxs.view = glm::translate(glm::mat4{1}, glm::vec3(0, 0, 3));
   ctx.mxs.model = glm::rotate(
       glm::rotate(
@@ -189,12 +343,15 @@ void init_model(Context& ctx, const Volume& shape, const std::vector<Plane>& cut
         -0.3f, glm::vec3{1, 0, 0}),
       0.2f, glm::vec3{0, 1, 0});
   glUseProgram(ctx.gl.prog_model);
-  glUniformMatrix4fv(ctx.gl.uniforms_model.modelview, 1, GL_FALSE, glm::value_ptr(ctx.mxs.view * ctx.mxs.model));
+  glUniform1i(ctx.gl.uniforms_model.pieces, texUnit);
+  set_modelview(ctx, ctx.mxs.view * ctx.mxs.model);
+  ctx.dirty.rotations = true;
+  ctx.dirty.frame = true;
 }
 
-void init_cubemap(Context& ctx, unsigned texUnit, const Volume& main_volume, const std::vector<Cut>& shape_cuts, const std::vector<Plane>& cuts) {
-  constexpr GLuint texSize = 1024;
-
+// Renders the mask in full precision, then reads it back quantized to 8 bits
+// per texel, the faces in the order of the GL_TEXTURE_CUBE_MAP_* targets
+std::vector<int8_t> paint_cubemap(GLuint texSize, const Volume& main_volume, const std::vector<Cut>& shape_cuts, const std::vector<Plane>& cuts) {
   struct {
     GLenum face;
     glm::mat4 proj;
@@ -236,13 +393,7 @@ void init_cubemap(Context& ctx, unsigned texUnit, const Volume& main_volume, con
 
   GLuint texture;
   glGenTextures(1, &texture);
-  glActiveTexture(GL_TEXTURE0 + texUnit);
   glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   for(auto& [face, proj] : faces)
     glTexImage2D(face, 0, GL_R32F, texSize, texSize, 0, GL_RED, GL_FLOAT, nullptr);
 
@@ -317,6 +468,9 @@ void init_cubemap(Context& ctx, unsigned texUnit, const Volume& main_volume, con
   glEnable(GL_BLEND);
   glBlendFunc(GL_DST_COLOR, GL_ZERO);
 
+  std::vector<GLfloat> pixels(texSize * texSize);
+  std::vector<int8_t> ret{};
+  ret.reserve(std::size(faces) * pixels.size());
   for(auto& [face, proj] : faces) {
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, face, texture, 0);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -335,17 +489,78 @@ void init_cubemap(Context& ctx, unsigned texUnit, const Volume& main_volume, con
       glUniform1ui(uniforms.p_tag, cut.tag);
       glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, nullptr);
     }
-  }
 
-  glUseProgram(ctx.gl.prog_model);
-  glUniform1i(ctx.gl.uniforms_model.texture, texUnit);
-  glHint(GL_FRAGMENT_SHADER_DERIVATIVE_HINT, GL_NICEST);
+    glReadPixels(0, 0, texSize, texSize, GL_RED, GL_FLOAT, pixels.data());
+    for(auto value : pixels)
+      ret.push_back(static_cast<int8_t>(std::lround(std::clamp(value, -1.f, 1.f) * 127)));
+  }
 
   // reset to sensible state
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteTextures(1, &texture);
   glDisable(GL_BLEND);
   glClearColor(0, 0, 0, 1);
+  return ret;
+}
+
+// The mask is only painted when it is not found in the cache. Either way it
+// is kept as GL_R8_SNORM; the sign matters, as model.frag averages samples
+// across cut lines.
+void init_cubemap(Context& ctx, unsigned texUnit, const Volume& main_volume, const std::vector<Cut>& shape_cuts, const std::vector<Plane>& cuts) {
+  constexpr GLuint texSize = 1024;
+
+  auto source = GLutil::readfile("texgen.vert") + GLutil::readfile("texgen.frag");
+  MaskCache cache{MaskCache::hash(main_volume, shape_cuts, cuts, source, texSize), texSize};
+  std::vector<int8_t> painted{};
+  auto texels = cache.load();
+  if(!texels) {
+    painted = paint_cubemap(texSize, main_volume, shape_cuts, cuts);
+    cache.store(painted);
+    texels = painted.data();
+  }
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glActiveTexture(GL_TEXTURE0 + texUnit);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for(GLuint i = 0; i < 6; i++)
+    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_R8_SNORM, texSize, texSize, 0, GL_RED, GL_BYTE,
+        *texels + i * texSize * texSize);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glUseProgram(ctx.gl.prog_model);
+  glUniform1i(ctx.gl.uniforms_model.texture, texUnit);
+  glHint(GL_FRAGMENT_SHADER_DERIVATIVE_HINT, GL_NICEST);
+}
+
+
+// Instead of init_cubemap(), lets model.frag compute the mask per fragment
+// from the planes themselves
+void init_cut_planes(Context& ctx, const std::vector<Cut>& shape_cuts, const std::vector<Plane>& cuts) {
+  std::size_t count = cuts.size() + shape_cuts.size();
+  if(count > max_cuts)
+    throw std::runtime_error("init_cut_planes: too many cuts");
+  std::vector<CutData> data{};
+  data.reserve(count);
+  for(const auto& plane : cuts)
+    data.push_back({plane.normal, plane.offset, 0, {}});
+  for(const auto& cut : shape_cuts)
+    data.push_back({cut.plane.normal, cut.plane.offset, cut.tag, {}});
+
+  glBindBuffer(GL_UNIFORM_BUFFER, ctx.gl.ubo_cuts);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size() * sizeof(data[0]), data.data());
+
+  glUseProgram(ctx.gl.prog_model);
+  glUniform1i(ctx.gl.uniforms_model.analytic, GL_TRUE);
+  glUniform1i(ctx.gl.uniforms_model.cut_count, count);
 }
 
 void init_click_target(Context& ctx) {
@@ -376,17 +591,13 @@ GLint get_click_volume(Context& ctx, glm::vec2 point) {
   glBindFramebuffer(GL_FRAMEBUFFER, ctx.gl.fb_click);
   glViewport(0, 0, 1, 1);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  upload_rotations(ctx);
   glUseProgram(ctx.gl.prog_click);
   glBindVertexArray(ctx.gl.vao_click);
   glUniformMatrix4fv(ctx.gl.uniforms_click.matrix, 1, GL_FALSE, glm::value_ptr(ctx.mxs.proj * ctx.mxs.view * ctx.mxs.model));
   glUniform2fv(ctx.gl.uniforms_click.location, 1, glm::value_ptr(point));
-  glBindVertexArray(ctx.gl.vao_model);
+  draw_pieces(ctx);
   GLint tag = 0;
-  for(auto& piece : ctx.pieces) {
-    glUniformMatrix4fv(ctx.gl.uniforms_click.submodel, 1, GL_FALSE, glm::value_ptr(piece.rotation));
-    glUniform1i(ctx.gl.uniforms_click.tag, ++tag);
-    glDrawElements(GL_TRIANGLES, piece.gl_count, GL_UNSIGNED_SHORT, piece.gl_start);
-  }
   glReadPixels(0, 0, 1, 1, GL_RED_INTEGER, GL_INT, &tag);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
   return tag;
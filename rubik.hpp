@@ -2,19 +2,22 @@
 #define RUBIK_HPP
 
 #include "Mould.hpp"
+#include "MeshCache.hpp"
+#include "MaskCache.hpp"
 #include "GLutil.hpp"
 #include <cmath>
+#include <limits>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Solid.hpp"
 
 struct Piece {
-  Volume volume;
   Vertex center;
   glm::mat4 rotation;
   GLvoid* gl_start;
   GLsizei gl_count;
+  GLint gl_base;
 };
 
 struct Context {
@@ -24,19 +27,40 @@ struct Context {
     GLutil::program prog_model;
     GLutil::program prog_click;
     struct {
-      GLint submodel;
+      GLint pieces;
       GLint modelview;
       GLint proj;
       GLint texture;
       GLint highlight;
+      GLint analytic;
+      GLint cut_count;
     } uniforms_model;
     struct {
       GLint matrix;
-      GLint submodel;
+      GLint pieces;
       GLint location;
-      GLint tag;
     } uniforms_click;
+    // Rotations of all the pieces, four RGBA texels (the matrix columns)
+    // per piece, up to 256 pieces to a row
+    GLuint tex_pieces;
+    unsigned texunit_pieces;
+    // Backing of the Cuts uniform block of prog_model
+    GLuint ubo_cuts;
+    // Last values sent to prog_model, to skip redundant uploads
+    glm::mat4 modelview;
+    GLint highlight;
     GLuint fb_click;
+    // Type of the model indices, and whether they are relative to each
+    // piece's gl_base
+    GLenum index_type;
+    bool base_vertex;
+    // Arguments of the multi-draw call covering all the pieces
+    struct {
+      std::vector<GLsizei> counts;
+      std::vector<const GLvoid*> starts;
+      std::vector<GLint> bases;
+      GLsizei total;
+    } draw_pieces;
     struct {
       GLsizei w;
       GLsizei h;
@@ -51,13 +75,19 @@ struct Context {
     glm::vec2 buttondown_loc;
     bool buttondown;
   } ui;
+  // What changed since it was last drawn or uploaded
+  struct {
+    bool frame;     // anything visible; the window needs redrawing
+    bool rotations; // Piece::rotation of some piece
+  } dirty;
   std::vector<Piece> pieces;
 };
 
-void init_programs(Context& ctx);
+void init_programs(Context& ctx, unsigned cuts_binding);
 Volume init_shape(Context& ctx, float size, const std::vector<Cut>& cuts);
-void init_model(Context& ctx, const Volume& shape, const std::vector<Plane>& cuts, const std::vector<glm::vec4>& colour_vals);
+void init_model(Context& ctx, unsigned texUnit, const Volume& shape, const std::vector<Plane>& cuts, const std::vector<glm::vec4>& colour_vals);
 void init_cubemap(Context& ctx, unsigned texUnit, const Volume& main_volume, const std::vector<Cut>& shape_cuts, const std::vector<Plane>& cuts);
+void init_cut_planes(Context& ctx, const std::vector<Cut>& shape_cuts, const std::vector<Plane>& cuts);
 void init_click_target(Context& ctx);
 
 void update_proj(Context& ctx, int w, int h);
@@ -66,11 +96,4 @@ GLint get_click_volume(Context& ctx, glm::vec2 point);
 
 void draw(Context& ctx, int);
 
-template<>
-struct element_traits<glm::mat4> {
-  static glm::mat4 identity() {
-    return glm::mat4{1};
-  }
-};
-
 #endif
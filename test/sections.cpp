@@ -0,0 +1,87 @@
+// Cuts the dihedral and Platonic shapes by their cut sets, then erodes and
+// dilates every piece, printing all the resulting volumes. `make test`
+// compares the output with test/sections.txt.
+#include <cstdio>
+#include <vector>
+
+#include "Mould.hpp"
+#include "Solid.hpp"
+
+void print(const Volume& volume) {
+  const auto& vertices = volume.get_vertices();
+  std::printf("volume %zu %zu\n", vertices.size(), volume.face_count());
+  for(const auto& vx : vertices)
+    std::printf(" %.9g %.9g %.9g\n", vx.x, vx.y, vx.z);
+  for(const auto& face : volume.get_faces()) {
+    std::printf(" [%u]", unsigned(face.tag));
+    for(auto ix : face.indices)
+      std::printf(" %u", unsigned(ix));
+    std::printf("\n");
+  }
+}
+
+void run(const char* name, const std::vector<Cut>& shape_cuts, const std::vector<Plane>& cuts) {
+  std::printf("%s\n", name);
+  Volume shape{2};
+  for(const auto& cut : shape_cuts)
+    shape.cut(cut.plane, cut.tag);
+  print(shape);
+  Mould mould{shape};
+  mould.cut_all(cuts);
+  std::printf("pieces %zu\n", mould.get_volumes().size());
+  for(auto volume : mould.get_volumes()) {
+    print(volume);
+    volume.erode(0.03);
+    volume.dilate(0.03);
+    print(volume);
+  }
+}
+
+// Shape cuts at the faces, and cuts through the edges and the center, as in
+// glfw.cpp
+void dihedral(unsigned n, float aspect) {
+  Solid shape = Solid::dihedral(n, aspect);
+  std::vector<Cut> shape_cuts{};
+  std::vector<Plane> cuts{};
+  Index ix = 0;
+  float r_edge = shape.r_edge();
+  for(const auto& [perm, vector] : shape.edge_dirs()) {
+    shape_cuts.push_back({{vector, r_edge}, ++ix});
+    cuts.push_back({vector, -r_edge / 2});
+    cuts.push_back({vector, r_edge / 4});
+  }
+  float r_face = shape.r_face();
+  for(const auto& [perm, vector] : shape.face_dirs()) {
+    shape_cuts.push_back({{vector, r_face}, ++ix});
+    cuts.push_back({vector, 0});
+  }
+  char name[32];
+  std::snprintf(name, sizeof(name), "dihedral %u", n);
+  run(name, shape_cuts, cuts);
+}
+
+// Shape cuts at the faces, and one cut a third of the way in parallel to each
+void platonic(unsigned p, unsigned q) {
+  Solid shape = Solid::platonic(p, q);
+  std::vector<Cut> shape_cuts{};
+  std::vector<Plane> cuts{};
+  Index ix = 0;
+  float r_face = shape.r_face();
+  for(const auto& [perm, vector] : shape.face_dirs()) {
+    shape_cuts.push_back({{vector, r_face}, ++ix});
+    cuts.push_back({vector, r_face / 3});
+  }
+  char name[32];
+  std::snprintf(name, sizeof(name), "platonic %u %u", p, q);
+  run(name, shape_cuts, cuts);
+}
+
+int main() {
+  dihedral(3, 0.5);
+  dihedral(5, 0.7);
+  platonic(3, 3);
+  platonic(4, 3);
+  platonic(3, 4);
+  platonic(5, 3);
+  platonic(3, 5);
+}